@@ -19,13 +19,16 @@ const uint8_t __mesh_dcd[] = {
     0x0b, 0x00, /* Features Bitmask = 0x000b */
     /* Begin Primary Element */
         0x00, 0x00, /* Location = 0x0000 */
-        0x02, /* Number of SIG Models = 0x02 */
-        0x00, /* Number of Vendor Models = 0x00 */
+        0x03, /* Number of SIG Models = 0x03 */
+        0x02, /* Number of Vendor Models = 0x02 */
         /* Begin SIG Models */
         0x02, 0x10, /* Generic Level Server */
+        0x01, 0x10, /* Generic OnOff Client */
         0x00, 0x00, /* Configuration Server */
         /* End SIG Models */
         /* Begin Vendor Models */
+        0xff, 0x02, 0x01, 0x00, /* Moisture Configuration (0x02ff:0x0001) */
+        0xff, 0x02, 0x02, 0x00, /* Moisture Sensor (0x02ff:0x0002) */
         /* End Vendor Models */
     /* End Primary Element */
 };
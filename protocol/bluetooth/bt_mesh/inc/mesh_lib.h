@@ -30,6 +30,28 @@ void mesh_lib_generic_server_event_handler(struct gecko_cmd_packet *evt);
 
 void mesh_lib_generic_client_event_handler(struct gecko_cmd_packet *evt);
 
+/* With MESH_LIB_COALESCE_STATE_CHANGES defined, server state changed
+   events are held instead of being delivered straight away, and only
+   the newest one for each model and element is kept. A change to a
+   different state of the same model delivers the held one first, so
+   no state is lost. The held changes are delivered by
+   mesh_lib_generic_server_flush(), which should be called whenever
+   the event queue runs dry. Without it, flushing does nothing and
+   every change is delivered as it arrives.
+
+   A held change is delivered with the remaining transition time it
+   arrived with; mesh_lib has no clock, so the time spent held isn't
+   taken off. Flushing whenever the queue runs dry keeps that short. */
+struct mesh_lib_coalesce_stats {
+  uint32_t held;      // state changes held for later delivery
+  uint32_t collapsed; // held changes replaced by a newer one
+  uint32_t delivered; // held changes delivered by a flush
+};
+
+void mesh_lib_generic_server_flush(void);
+
+void mesh_lib_get_coalesce_stats(struct mesh_lib_coalesce_stats *stats);
+
 /***
  *** Generic Server
  ***/
@@ -1,6 +1,11 @@
 #ifndef MESH_SERDESER_H
 #define MESH_SERDESER_H
 
+#include <stddef.h>
+#include <stdint.h>
+
+#include "mesh_generic_model_capi_types.h"
+
 int mesh_lib_serialize_state(const struct mesh_generic_state *current,
                              const struct mesh_generic_state *target,
                              uint8_t *msg_buf,
@@ -24,4 +29,122 @@ int mesh_lib_deserialize_request(struct mesh_generic_request *req,
                                  const uint8_t *msg_buf,
                                  size_t msg_len);
 
+/***
+ *** Message views
+ ***/
+
+/* A view reads fields straight out of a received message instead of
+   copying them into a mesh_generic_request or mesh_generic_state first.
+   Opening a view checks the message length for its kind, with the same
+   rules as the deserializers; after that the readers below only check
+   that the field lies inside the message, and read as zero if it does
+   not. The view points into the message buffer, so it is only good for
+   as long as the event that carried the message. */
+struct mesh_lib_view {
+  int kind;             // mesh_generic_request_t or mesh_generic_state_t
+  const uint8_t *buf;
+  size_t len;
+};
+
+int mesh_lib_view_request(struct mesh_lib_view *req,
+                          mesh_generic_request_t kind,
+                          const uint8_t *msg_buf,
+                          size_t msg_len);
+
+/* A state with a target is the current value followed by the target
+   value in the same layout, so the target gets a view of its own */
+int mesh_lib_view_state(struct mesh_lib_view *current,
+                        struct mesh_lib_view *target,
+                        int *has_target,
+                        mesh_generic_state_t kind,
+                        const uint8_t *msg_buf,
+                        size_t msg_len);
+
+/* Field offsets for the kinds with more than one field. Single field
+   kinds (on/off, level, lightness, ...) have their value at offset 0. */
+#define MESH_VIEW_RANGE_MIN                   0  // u16, request ranges
+#define MESH_VIEW_RANGE_MAX                   2  // u16, request ranges
+#define MESH_VIEW_POWER_RANGE_STATUS          0  // u8, state
+#define MESH_VIEW_POWER_RANGE_MIN             1  // u16, state
+#define MESH_VIEW_POWER_RANGE_MAX             3  // u16, state
+#define MESH_VIEW_LOCATION_GLOBAL_LAT         0  // s32
+#define MESH_VIEW_LOCATION_GLOBAL_LON         4  // s32
+#define MESH_VIEW_LOCATION_GLOBAL_ALT         8  // s16
+#define MESH_VIEW_LOCATION_LOCAL_NORTH        0  // s16
+#define MESH_VIEW_LOCATION_LOCAL_EAST         2  // s16
+#define MESH_VIEW_LOCATION_LOCAL_ALT          4  // s16
+#define MESH_VIEW_LOCATION_LOCAL_FLOOR        6  // u8
+#define MESH_VIEW_LOCATION_LOCAL_UNCERTAINTY  7  // u16
+#define MESH_VIEW_BATTERY_LEVEL               0  // u8
+#define MESH_VIEW_BATTERY_DISCHARGE_TIME      1  // u24
+#define MESH_VIEW_BATTERY_CHARGE_TIME         4  // u24
+#define MESH_VIEW_BATTERY_FLAGS               7  // u8
+#define MESH_VIEW_PROPERTY_ID                 0  // u16
+#define MESH_VIEW_PROPERTY_ACCESS             2  // u8, not in user requests
+#define MESH_VIEW_PROPERTY_USER_VALUE         2  // bytes, user requests
+#define MESH_VIEW_PROPERTY_VALUE              3  // bytes, everything else
+#define MESH_VIEW_CTL_LIGHTNESS               0  // u16
+#define MESH_VIEW_CTL_TEMPERATURE             2  // u16
+#define MESH_VIEW_CTL_DELTAUV                 4  // s16
+#define MESH_VIEW_CTL_TEMPERATURE_TEMPERATURE 0  // u16, ctl temperature request
+#define MESH_VIEW_CTL_TEMPERATURE_DELTAUV     2  // s16, ctl temperature request
+
+static inline uint8_t mesh_lib_view_u8(const struct mesh_lib_view *view,
+                                       size_t off)
+{
+  return (off < view->len) ? view->buf[off] : 0;
+}
+
+static inline uint16_t mesh_lib_view_u16(const struct mesh_lib_view *view,
+                                         size_t off)
+{
+  if (off + 2 > view->len) {
+    return 0;
+  }
+  return ((uint16_t)view->buf[off]) | ((uint16_t)view->buf[off + 1] << 8);
+}
+
+static inline int16_t mesh_lib_view_s16(const struct mesh_lib_view *view,
+                                        size_t off)
+{
+  return (int16_t)mesh_lib_view_u16(view, off);
+}
+
+static inline uint32_t mesh_lib_view_u24(const struct mesh_lib_view *view,
+                                         size_t off)
+{
+  if (off + 3 > view->len) {
+    return 0;
+  }
+  return ((uint32_t)view->buf[off])
+         | ((uint32_t)view->buf[off + 1] << 8)
+         | ((uint32_t)view->buf[off + 2] << 16);
+}
+
+static inline int32_t mesh_lib_view_s32(const struct mesh_lib_view *view,
+                                        size_t off)
+{
+  if (off + 4 > view->len) {
+    return 0;
+  }
+  return (int32_t)(((uint32_t)view->buf[off])
+                   | ((uint32_t)view->buf[off + 1] << 8)
+                   | ((uint32_t)view->buf[off + 2] << 16)
+                   | ((uint32_t)view->buf[off + 3] << 24));
+}
+
+/* The rest of the message from off onwards, for property values and
+   property lists. NULL with *len of 0 if there is nothing there. */
+static inline const uint8_t *mesh_lib_view_bytes(const struct mesh_lib_view *view,
+                                                 size_t off,
+                                                 size_t *len)
+{
+  if (off >= view->len) {
+    *len = 0;
+    return NULL;
+  }
+  *len = view->len - off;
+  return &view->buf[off];
+}
+
 #endif // MESH_SERDESER_H
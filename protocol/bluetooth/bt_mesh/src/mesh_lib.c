@@ -1,5 +1,6 @@
 #include <stdint.h>
 #include <stdlib.h>
+#include <string.h>
 
 /* BG stack headers */
 #include "bg_types.h"
@@ -21,6 +22,30 @@
 #include "mesh_lib.h"
 #include "mesh_serdeser.h"
 
+#if defined(MESH_LIB_STATIC_ALLOC)
+/* The registration table is a static array sized from the node's
+   memory configuration instead of coming from the heap */
+#include "mesh_app_memory_config.h"
+
+/* MESH_CFG_MAX_MODELS already counts the models on every element, and
+   each model can only register once per element it's on */
+#ifndef MESH_LIB_STATIC_REGS
+#define MESH_LIB_STATIC_REGS MESH_CFG_MAX_MODELS
+#endif
+
+#if MESH_LIB_STATIC_REGS < MESH_CFG_MAX_ELEMENTS
+#error "MESH_LIB_STATIC_REGS must allow at least one model per element"
+#endif
+#endif /* MESH_LIB_STATIC_ALLOC */
+
+#if defined(MESH_LIB_COALESCE_STATE_CHANGES)
+/* State changes bigger than this are delivered straight away. 12 bytes
+   covers every fixed size state, target included. */
+#ifndef MESH_LIB_COALESCE_MAX_LEN
+#define MESH_LIB_COALESCE_MAX_LEN 12
+#endif
+#endif /* MESH_LIB_COALESCE_STATE_CHANGES */
+
 uint32_t mesh_lib_transition_time_to_ms(uint8_t t)
 {
   uint32_t res_ms[4] = { 100, 1000, 10000, 600000 };
@@ -32,6 +57,7 @@ uint32_t mesh_lib_transition_time_to_ms(uint8_t t)
 struct reg {
   uint16_t model_id;
   uint16_t elem_index;
+  uint16_t next; // next registration in the same hash chain
   union {
     struct {
       mesh_lib_generic_server_client_request_cb client_request_cb;
@@ -41,50 +67,193 @@ struct reg {
       mesh_lib_generic_client_server_response_cb server_response_cb;
     } client;
   };
+#if defined(MESH_LIB_COALESCE_STATE_CHANGES)
+  struct {
+    uint8_t pending;
+    uint8_t type;
+    uint8_t len;
+    uint8_t data[MESH_LIB_COALESCE_MAX_LEN];
+    uint32_t remaining;
+  } change; // newest state change not yet delivered
+#endif
 };
 
+/* Registrations are looked up on every generic event, so they are
+   indexed instead of scanned. The SIG generic models on the first
+   MESH_LIB_DIRECT_ELEMENTS elements go in a direct-mapped table; any
+   other model or element is hashed into chains that run through the
+   registration table. Registrations are handed out in order and never
+   removed short of mesh_lib_deinit(). Indexes are stored plus one so
+   that zero means none. */
+#define DIRECT_MODEL_BASE MESH_GENERIC_ON_OFF_SERVER_MODEL_ID
+#define DIRECT_MODELS \
+  (MESH_GENERIC_PROPERTY_CLIENT_MODEL_ID - DIRECT_MODEL_BASE + 1)
+
+#ifndef MESH_LIB_DIRECT_ELEMENTS
+#if defined(MESH_LIB_STATIC_ALLOC)
+#define MESH_LIB_DIRECT_ELEMENTS MESH_CFG_MAX_ELEMENTS
+#else
+#define MESH_LIB_DIRECT_ELEMENTS 1
+#endif
+#endif
+
 static struct reg *reg = NULL;
 static size_t regs = 0;
+static size_t used = 0;
+static uint16_t *bucket = NULL;
+static uint16_t direct[MESH_LIB_DIRECT_ELEMENTS][DIRECT_MODELS];
+
+static struct mesh_lib_coalesce_stats coalesce_stats;
+#if defined(MESH_LIB_COALESCE_STATE_CHANGES)
+static size_t changes_held = 0;
+#endif
 
+#if defined(MESH_LIB_STATIC_ALLOC)
+static struct reg reg_table[MESH_LIB_STATIC_REGS];
+static uint16_t bucket_table[MESH_LIB_STATIC_REGS];
+#else
 static void *(*lib_malloc_fn)(size_t) = NULL;
 static void (*lib_free_fn)(void *) = NULL;
+#endif
+
+static uint16_t *find_direct(uint16_t model_id,
+                             uint16_t elem_index)
+{
+  if (elem_index < MESH_LIB_DIRECT_ELEMENTS
+      && model_id >= DIRECT_MODEL_BASE
+      && model_id - DIRECT_MODEL_BASE < DIRECT_MODELS) {
+    return &direct[elem_index][model_id - DIRECT_MODEL_BASE];
+  }
+  return NULL;
+}
+
+static size_t hash_reg(uint16_t model_id,
+                       uint16_t elem_index)
+{
+  uint32_t key = ((uint32_t)elem_index << 16) | model_id;
+  return (size_t)((key * 2654435761u) % regs);
+}
 
 static struct reg *find_reg(uint16_t model_id,
                             uint16_t elem_index)
 {
-  size_t r;
-  for (r = 0; r < regs; r++) {
-    if (reg[r].model_id == model_id && reg[r].elem_index == elem_index) {
-      return &reg[r];
+  uint16_t *slot;
+  uint16_t r;
+
+  if (!regs) {
+    return NULL;
+  }
+
+  slot = find_direct(model_id, elem_index);
+  if (slot) {
+    return *slot ? &reg[*slot - 1] : NULL;
+  }
+
+  for (r = bucket[hash_reg(model_id, elem_index)]; r; r = reg[r - 1].next) {
+    if (reg[r - 1].model_id == model_id && reg[r - 1].elem_index == elem_index) {
+      return &reg[r - 1];
     }
   }
   return NULL;
 }
 
-static struct reg *find_free(void)
+static struct reg *add_reg(uint16_t model_id,
+                           uint16_t elem_index)
 {
-  size_t r;
-  for (r = 0; r < regs; r++) {
-    if (reg[r].model_id == 0x0000 && reg[r].elem_index == 0x0000) {
-      return &reg[r];
-    }
+  struct reg *r;
+  uint16_t *slot;
+  size_t h;
+
+  if (used >= regs) {
+    return NULL;
   }
-  return NULL;
+
+  r = &reg[used++];
+  r->model_id = model_id;
+  r->elem_index = elem_index;
+
+  slot = find_direct(model_id, elem_index);
+  if (slot) {
+    *slot = (uint16_t)used;
+  } else {
+    h = hash_reg(model_id, elem_index);
+    r->next = bucket[h];
+    bucket[h] = (uint16_t)used;
+  }
+  return r;
 }
 
+#if defined(MESH_LIB_STATIC_ALLOC)
+/* In static mode the allocator functions are not used and may be NULL;
+   generic_models only has to fit in the table */
 errorcode_t mesh_lib_init(void *(*malloc_fn)(size_t),
                           void (*free_fn)(void *),
                           size_t generic_models)
 {
+  (void)malloc_fn;
+  (void)free_fn;
+
+  if (generic_models > MESH_LIB_STATIC_REGS) {
+    return bg_err_out_of_memory;
+  }
+
+  memset(reg_table, 0, sizeof(reg_table));
+  memset(bucket_table, 0, sizeof(bucket_table));
+  memset(direct, 0, sizeof(direct));
+  reg = reg_table;
+  bucket = bucket_table;
+  regs = generic_models;
+  used = 0;
+#if defined(MESH_LIB_COALESCE_STATE_CHANGES)
+  changes_held = 0;
+#endif
+  memset(&coalesce_stats, 0, sizeof(coalesce_stats));
+
+  return bg_err_success;
+}
+
+void mesh_lib_deinit(void)
+{
+  memset(reg_table, 0, sizeof(reg_table));
+  memset(bucket_table, 0, sizeof(bucket_table));
+  memset(direct, 0, sizeof(direct));
+  reg = NULL;
+  bucket = NULL;
+  regs = 0;
+  used = 0;
+#if defined(MESH_LIB_COALESCE_STATE_CHANGES)
+  changes_held = 0;
+#endif
+}
+#else
+errorcode_t mesh_lib_init(void *(*malloc_fn)(size_t),
+                          void (*free_fn)(void *),
+                          size_t generic_models)
+{
+  size_t size;
+
   lib_malloc_fn = malloc_fn;
   lib_free_fn = free_fn;
 
+  memset(direct, 0, sizeof(direct));
+  used = 0;
+#if defined(MESH_LIB_COALESCE_STATE_CHANGES)
+  changes_held = 0;
+#endif
+  memset(&coalesce_stats, 0, sizeof(coalesce_stats));
+
   if (generic_models) {
-    reg = (lib_malloc_fn)(generic_models * sizeof(struct reg));
+    if (generic_models >= UINT16_MAX) {
+      return bg_err_invalid_param; // indexes are 16 bits
+    }
+    /* The hash buckets share the allocation, one per registration */
+    size = generic_models * (sizeof(struct reg) + sizeof(uint16_t));
+    reg = (lib_malloc_fn)(size);
     if (!reg) {
       return bg_err_out_of_memory;
     }
-    memset(reg, 0, generic_models * sizeof(struct reg));
+    memset(reg, 0, size);
+    bucket = (uint16_t *)&reg[generic_models];
     regs = generic_models;
   }
 
@@ -96,9 +265,15 @@ void mesh_lib_deinit(void)
   if (reg) {
     (lib_free_fn)(reg);
     reg = NULL;
+    bucket = NULL;
     regs = 0;
+    used = 0;
+#if defined(MESH_LIB_COALESCE_STATE_CHANGES)
+    changes_held = 0;
+#endif
   }
 }
+#endif /* MESH_LIB_STATIC_ALLOC */
 
 errorcode_t
 mesh_lib_generic_server_register_handler(uint16_t model_id,
@@ -113,13 +288,11 @@ mesh_lib_generic_server_register_handler(uint16_t model_id,
     return bg_err_wrong_state; // already exists
   }
 
-  reg = find_free();
+  reg = add_reg(model_id, elem_index);
   if (!reg) {
     return bg_err_out_of_memory;
   }
 
-  reg->model_id = model_id;
-  reg->elem_index = elem_index;
   reg->server.client_request_cb = cb;
   reg->server.state_changed_cb = ch;
   return bg_err_success;
@@ -137,25 +310,102 @@ mesh_lib_generic_client_register_handler(uint16_t model_id,
     return bg_err_wrong_state; // already exists
   }
 
-  reg = find_free();
+  reg = add_reg(model_id, elem_index);
   if (!reg) {
     return bg_err_out_of_memory;
   }
 
-  reg->model_id = model_id;
-  reg->elem_index = elem_index;
   reg->client.server_response_cb = cb;
   return bg_err_success;
 }
 
+static void deliver_state_change(struct reg *reg,
+                                 uint8_t type,
+                                 const uint8_t *data,
+                                 size_t len,
+                                 uint32_t remaining)
+{
+  struct mesh_generic_state current;
+  struct mesh_generic_state target;
+  int has_target;
+
+  if (mesh_lib_deserialize_state(&current,
+                                 &target,
+                                 &has_target,
+                                 type,
+                                 data,
+                                 len) == 0) {
+    (reg->server.state_changed_cb)(reg->model_id,
+                                   reg->elem_index,
+                                   &current,
+                                   has_target ? &target : NULL,
+                                   remaining);
+  }
+}
+
+#if defined(MESH_LIB_COALESCE_STATE_CHANGES)
+static void flush_state_change(struct reg *reg)
+{
+  if (!reg->change.pending) {
+    return;
+  }
+
+  reg->change.pending = 0;
+  changes_held--;
+  coalesce_stats.delivered++;
+  deliver_state_change(reg,
+                       reg->change.type,
+                       reg->change.data,
+                       reg->change.len,
+                       reg->change.remaining);
+}
+
+static void hold_state_change(struct reg *reg,
+                              uint8_t type,
+                              const uint8_t *data,
+                              size_t len,
+                              uint32_t remaining)
+{
+  // only a newer value of the same state replaces what's held
+  if (reg->change.pending && reg->change.type != type) {
+    flush_state_change(reg);
+  }
+  if (reg->change.pending) {
+    coalesce_stats.collapsed++;
+  } else {
+    reg->change.pending = 1;
+    changes_held++;
+  }
+  coalesce_stats.held++;
+
+  reg->change.type = type;
+  reg->change.len = len;
+  memcpy(reg->change.data, data, len);
+  reg->change.remaining = remaining;
+}
+#endif /* MESH_LIB_COALESCE_STATE_CHANGES */
+
+void mesh_lib_generic_server_flush(void)
+{
+#if defined(MESH_LIB_COALESCE_STATE_CHANGES)
+  size_t r;
+
+  for (r = 0; r < used && changes_held; r++) {
+    flush_state_change(&reg[r]);
+  }
+#endif
+}
+
+void mesh_lib_get_coalesce_stats(struct mesh_lib_coalesce_stats *stats)
+{
+  *stats = coalesce_stats;
+}
+
 void mesh_lib_generic_server_event_handler(struct gecko_cmd_packet *evt)
 {
   struct gecko_msg_mesh_generic_server_client_request_evt_t *req = NULL;
   struct gecko_msg_mesh_generic_server_state_changed_evt_t *chg = NULL;
   struct mesh_generic_request request;
-  struct mesh_generic_state current;
-  struct mesh_generic_state target;
-  int has_target;
   struct reg *reg;
 
   if (!evt) {
@@ -187,18 +437,23 @@ void mesh_lib_generic_server_event_handler(struct gecko_cmd_packet *evt)
       chg = &(evt->data.evt_mesh_generic_server_state_changed);
       reg = find_reg(chg->model_id, chg->elem_index);
       if (reg) {
-        if (mesh_lib_deserialize_state(&current,
-                                       &target,
-                                       &has_target,
-                                       chg->type,
-                                       chg->parameters.data,
-                                       chg->parameters.len) == 0) {
-          (reg->server.state_changed_cb)(chg->model_id,
-                                         chg->elem_index,
-                                         &current,
-                                         has_target ? &target : NULL,
-                                         chg->remaining);
+#if defined(MESH_LIB_COALESCE_STATE_CHANGES)
+        if (chg->parameters.len <= sizeof(reg->change.data)) {
+          hold_state_change(reg,
+                            chg->type,
+                            chg->parameters.data,
+                            chg->parameters.len,
+                            chg->remaining);
+          break;
         }
+        // too big to hold; whatever is held is older, so it goes first
+        flush_state_change(reg);
+#endif
+        deliver_state_change(reg,
+                             chg->type,
+                             chg->parameters.data,
+                             chg->parameters.len,
+                             chg->remaining);
       }
       break;
   }
@@ -1,53 +1,377 @@
 #include <stdint.h>
-#include <stdlib.h>
-#include <errno.h>
+#include <stddef.h>
 #include <string.h>
 
-/* BG stack headers */
-#include "bg_types.h"
-#include "bg_compat.h"
-
+/* The codec needs nothing from the stack, only the model types, so it
+   builds as-is on a host for testing against untrusted input */
 #include "mesh_generic_model_capi_types.h"
 #include "mesh_serdeser.h"
 
-static int16_t int16_from_buf(const uint8_t *ptr)
+/* Every request and state kind is described by a row in one of the
+   tables below: the fields it puts on the air, in order, with their
+   width and where they live in struct mesh_generic_request or struct
+   mesh_generic_state, plus whether the message may end in a variable
+   length value or carry a target value after the current one. One
+   encoder and one decoder walk the rows, so a new kind is a new row. */
+
+#define CODEC_KNOWN  0x01 // row is in use
+#define CODEC_TARGET 0x02 // may be followed by a target of the same layout
+#define CODEC_VALUE  0x04 // ends in a variable length value
+#define CODEC_PAIRS  0x08 // the value is a whole number of 16-bit IDs
+#define CODEC_CLEAR  0x10 // has a value in the struct, but not on the air
+
+#define CODEC_MAX_FIELDS 5
+
+struct codec_field {
+  uint8_t width; // bytes on the air; 3 is a byte array, 0 ends the list
+  uint8_t at;    // offset in the request or state
+};
+
+/* Where the variable length value's length, offset and buffer live */
+struct codec_tail {
+  uint8_t length;
+  uint8_t offset;
+  uint8_t buffer;
+};
+
+struct codec {
+  uint8_t flags;
+  struct codec_field field[CODEC_MAX_FIELDS];
+  struct codec_tail tail;
+};
+
+#define R(member) offsetof(struct mesh_generic_request, member)
+#define S(member) offsetof(struct mesh_generic_state, member)
+#define R_TAIL(member) \
+  { R(member.length), R(member.offset), R(member.buffer) }
+#define S_TAIL(member) \
+  { S(member.length), S(member.offset), S(member.buffer) }
+
+/* Tables are indexed by kind, with the lighting kinds (0x80 on) packed
+   in after the generic ones */
+#define REQUEST_GENERIC_KINDS (mesh_generic_request_property_manuf + 1)
+#define REQUEST_SLOT(kind) \
+  ((kind) >= 0x80 ? REQUEST_GENERIC_KINDS + ((kind) - 0x80) : (kind))
+#define REQUEST_SLOTS \
+  (REQUEST_SLOT(mesh_lighting_request_ctl_temperature_range) + 1)
+
+#define STATE_GENERIC_KINDS (mesh_generic_state_property_list_client + 1)
+#define STATE_SLOT(kind) \
+  ((kind) >= 0x80 ? STATE_GENERIC_KINDS + ((kind) - 0x80) : (kind))
+#define STATE_SLOTS STATE_SLOT(mesh_generic_state_last)
+
+static const struct codec request_codec[REQUEST_SLOTS] = {
+  [REQUEST_SLOT(mesh_generic_request_on_off)] =
+  { CODEC_KNOWN, { { 1, R(on_off) } } },
+  [REQUEST_SLOT(mesh_generic_request_on_power_up)] =
+  { CODEC_KNOWN, { { 1, R(on_power_up) } } },
+  [REQUEST_SLOT(mesh_generic_request_level)] =
+  { CODEC_KNOWN, { { 2, R(level) } } },
+  [REQUEST_SLOT(mesh_generic_request_level_delta)] =
+  { CODEC_KNOWN, { { 4, R(delta) } } },
+  [REQUEST_SLOT(mesh_generic_request_level_move)] =
+  { CODEC_KNOWN, { { 2, R(level) } } },
+  [REQUEST_SLOT(mesh_generic_request_level_halt)] =
+  { CODEC_KNOWN, { { 2, R(level) } } },
+  [REQUEST_SLOT(mesh_generic_request_power_level)] =
+  { CODEC_KNOWN, { { 2, R(power_level) } } },
+  [REQUEST_SLOT(mesh_generic_request_power_level_default)] =
+  { CODEC_KNOWN, { { 2, R(power_level) } } },
+  [REQUEST_SLOT(mesh_generic_request_power_level_range)] =
+  { CODEC_KNOWN, { { 2, R(power_range[0]) }, { 2, R(power_range[1]) } } },
+  [REQUEST_SLOT(mesh_generic_request_transition_time)] =
+  { CODEC_KNOWN, { { 1, R(transition_time) } } },
+  [REQUEST_SLOT(mesh_generic_request_location_global)] =
+  { CODEC_KNOWN, { { 4, R(location_global.lat) },
+                   { 4, R(location_global.lon) },
+                   { 2, R(location_global.alt) } } },
+  [REQUEST_SLOT(mesh_generic_request_location_local)] =
+  { CODEC_KNOWN, { { 2, R(location_local.north) },
+                   { 2, R(location_local.east) },
+                   { 2, R(location_local.alt) },
+                   { 1, R(location_local.floor) },
+                   { 2, R(location_local.uncertainty) } } },
+  [REQUEST_SLOT(mesh_generic_request_property_user)] =
+  { CODEC_KNOWN | CODEC_VALUE, { { 2, R(property.id) } },
+    R_TAIL(property) },
+  [REQUEST_SLOT(mesh_generic_request_property_admin)] =
+  { CODEC_KNOWN | CODEC_VALUE, { { 2, R(property.id) },
+                                 { 1, R(property.access) } },
+    R_TAIL(property) },
+  [REQUEST_SLOT(mesh_generic_request_property_manuf)] =
+  { CODEC_KNOWN | CODEC_CLEAR, { { 2, R(property.id) },
+                                 { 1, R(property.access) } },
+    R_TAIL(property) },
+  [REQUEST_SLOT(mesh_lighting_request_lightness_actual)] =
+  { CODEC_KNOWN, { { 2, R(lightness) } } },
+  [REQUEST_SLOT(mesh_lighting_request_lightness_linear)] =
+  { CODEC_KNOWN, { { 2, R(lightness) } } },
+  [REQUEST_SLOT(mesh_lighting_request_lightness_default)] =
+  { CODEC_KNOWN, { { 2, R(lightness) } } },
+  [REQUEST_SLOT(mesh_lighting_request_lightness_range)] =
+  { CODEC_KNOWN, { { 2, R(lightness_range.min) },
+                   { 2, R(lightness_range.max) } } },
+  [REQUEST_SLOT(mesh_lighting_request_ctl)] =
+  { CODEC_KNOWN, { { 2, R(ctl.lightness) },
+                   { 2, R(ctl.temperature) },
+                   { 2, R(ctl.deltauv) } } },
+  [REQUEST_SLOT(mesh_lighting_request_ctl_temperature)] =
+  { CODEC_KNOWN, { { 2, R(ctl_temperature.temperature) },
+                   { 2, R(ctl_temperature.deltauv) } } },
+  [REQUEST_SLOT(mesh_lighting_request_ctl_default)] =
+  { CODEC_KNOWN, { { 2, R(ctl.lightness) },
+                   { 2, R(ctl.temperature) },
+                   { 2, R(ctl.deltauv) } } },
+  [REQUEST_SLOT(mesh_lighting_request_ctl_temperature_range)] =
+  { CODEC_KNOWN, { { 2, R(ctl_temperature_range.min) },
+                   { 2, R(ctl_temperature_range.max) } } },
+};
+
+static const struct codec state_codec[STATE_SLOTS] = {
+  [STATE_SLOT(mesh_generic_state_on_off)] =
+  { CODEC_KNOWN | CODEC_TARGET, { { 1, S(on_off.on) } } },
+  [STATE_SLOT(mesh_generic_state_on_power_up)] =
+  { CODEC_KNOWN, { { 1, S(on_power_up.on_power_up) } } },
+  [STATE_SLOT(mesh_generic_state_level)] =
+  { CODEC_KNOWN | CODEC_TARGET, { { 2, S(level.level) } } },
+  [STATE_SLOT(mesh_generic_state_power_level)] =
+  { CODEC_KNOWN | CODEC_TARGET, { { 2, S(power_level.level) } } },
+  [STATE_SLOT(mesh_generic_state_power_level_last)] =
+  { CODEC_KNOWN, { { 2, S(power_level_last.level) } } },
+  [STATE_SLOT(mesh_generic_state_power_level_default)] =
+  { CODEC_KNOWN, { { 2, S(power_level_default.level) } } },
+  [STATE_SLOT(mesh_generic_state_power_level_range)] =
+  { CODEC_KNOWN, { { 1, S(power_level_range.status) },
+                   { 2, S(power_level_range.min) },
+                   { 2, S(power_level_range.max) } } },
+  [STATE_SLOT(mesh_generic_state_transition_time)] =
+  { CODEC_KNOWN, { { 1, S(transition_time.time) } } },
+  [STATE_SLOT(mesh_generic_state_battery)] =
+  { CODEC_KNOWN, { { 1, S(battery.level) },
+                   { 3, S(battery.discharge_time) },
+                   { 3, S(battery.charge_time) },
+                   { 1, S(battery.flags) } } },
+  [STATE_SLOT(mesh_generic_state_location_global)] =
+  { CODEC_KNOWN, { { 4, S(location_global.lat) },
+                   { 4, S(location_global.lon) },
+                   { 2, S(location_global.alt) } } },
+  [STATE_SLOT(mesh_generic_state_location_local)] =
+  { CODEC_KNOWN, { { 2, S(location_local.north) },
+                   { 2, S(location_local.east) },
+                   { 2, S(location_local.alt) },
+                   { 1, S(location_local.floor) },
+                   { 2, S(location_local.uncertainty) } } },
+  [STATE_SLOT(mesh_generic_state_property_user)] =
+  { CODEC_KNOWN | CODEC_VALUE, { { 2, S(property.id) },
+                                 { 1, S(property.access) } },
+    S_TAIL(property) },
+  [STATE_SLOT(mesh_generic_state_property_admin)] =
+  { CODEC_KNOWN | CODEC_VALUE, { { 2, S(property.id) },
+                                 { 1, S(property.access) } },
+    S_TAIL(property) },
+  [STATE_SLOT(mesh_generic_state_property_manuf)] =
+  { CODEC_KNOWN | CODEC_VALUE, { { 2, S(property.id) },
+                                 { 1, S(property.access) } },
+    S_TAIL(property) },
+  [STATE_SLOT(mesh_generic_state_property_list_user)] =
+  { CODEC_KNOWN | CODEC_VALUE | CODEC_PAIRS, { { 0, 0 } },
+    S_TAIL(property_list) },
+  [STATE_SLOT(mesh_generic_state_property_list_admin)] =
+  { CODEC_KNOWN | CODEC_VALUE | CODEC_PAIRS, { { 0, 0 } },
+    S_TAIL(property_list) },
+  [STATE_SLOT(mesh_generic_state_property_list_manuf)] =
+  { CODEC_KNOWN | CODEC_VALUE | CODEC_PAIRS, { { 0, 0 } },
+    S_TAIL(property_list) },
+  [STATE_SLOT(mesh_generic_state_property_list_client)] =
+  { CODEC_KNOWN | CODEC_VALUE | CODEC_PAIRS, { { 0, 0 } },
+    S_TAIL(property_list) },
+  [STATE_SLOT(mesh_lighting_state_lightness_actual)] =
+  { CODEC_KNOWN | CODEC_TARGET, { { 2, S(lightness.level) } } },
+  [STATE_SLOT(mesh_lighting_state_lightness_linear)] =
+  { CODEC_KNOWN | CODEC_TARGET, { { 2, S(lightness.level) } } },
+  [STATE_SLOT(mesh_lighting_state_lightness_last)] =
+  { CODEC_KNOWN, { { 2, S(lightness.level) } } },
+  [STATE_SLOT(mesh_lighting_state_lightness_default)] =
+  { CODEC_KNOWN, { { 2, S(lightness.level) } } },
+  [STATE_SLOT(mesh_lighting_state_lightness_range)] =
+  { CODEC_KNOWN, { { 2, S(lightness_range.min) },
+                   { 2, S(lightness_range.max) } } },
+  [STATE_SLOT(mesh_lighting_state_ctl)] =
+  { CODEC_KNOWN | CODEC_TARGET, { { 2, S(ctl.lightness) },
+                                  { 2, S(ctl.temperature) },
+                                  { 2, S(ctl.deltauv) } } },
+  [STATE_SLOT(mesh_lighting_state_ctl_temperature)] =
+  { CODEC_KNOWN | CODEC_TARGET, { { 2, S(ctl.lightness) },
+                                  { 2, S(ctl.temperature) },
+                                  { 2, S(ctl.deltauv) } } },
+  [STATE_SLOT(mesh_lighting_state_ctl_default)] =
+  { CODEC_KNOWN, { { 2, S(ctl.lightness) },
+                   { 2, S(ctl.temperature) },
+                   { 2, S(ctl.deltauv) } } },
+  [STATE_SLOT(mesh_lighting_state_ctl_temperature_range)] =
+  { CODEC_KNOWN, { { 2, S(ctl_temperature_range.min) },
+                   { 2, S(ctl_temperature_range.max) } } },
+};
+
+static const struct codec *find_request_codec(int kind)
+{
+  if (kind < 0 || (kind < 0x80 && kind >= REQUEST_GENERIC_KINDS)
+      || REQUEST_SLOT(kind) >= REQUEST_SLOTS
+      || !(request_codec[REQUEST_SLOT(kind)].flags & CODEC_KNOWN)) {
+    return NULL;
+  }
+  return &request_codec[REQUEST_SLOT(kind)];
+}
+
+static const struct codec *find_state_codec(int kind)
 {
-  return ((int16_t)ptr[0]) | ((int16_t)ptr[1] << 8);
+  if (kind < 0 || (kind < 0x80 && kind >= STATE_GENERIC_KINDS)
+      || STATE_SLOT(kind) >= STATE_SLOTS
+      || !(state_codec[STATE_SLOT(kind)].flags & CODEC_KNOWN)) {
+    return NULL;
+  }
+  return &state_codec[STATE_SLOT(kind)];
+}
+
+/* Bytes the fixed fields take on the air */
+static size_t codec_size(const struct codec *codec)
+{
+  size_t size = 0;
+  size_t f;
+
+  for (f = 0; f < CODEC_MAX_FIELDS && codec->field[f].width; f++) {
+    size += codec->field[f].width;
+  }
+  return size;
+}
+
+/* -1 if a message of msg_len bytes can't be this kind, 1 if it carries
+   a target, 0 otherwise */
+static int codec_fit(const struct codec *codec, size_t size, size_t msg_len)
+{
+  if (codec->flags & CODEC_VALUE) {
+    if (msg_len < size) {
+      return -1;
+    }
+    if ((codec->flags & CODEC_PAIRS) && ((msg_len - size) & 0x01)) {
+      return -1;
+    }
+    return 0;
+  }
+  if ((codec->flags & CODEC_TARGET) && msg_len == 2 * size) {
+    return 1;
+  }
+  return (msg_len == size) ? 0 : -1;
 }
 
-static void int16_to_buf(uint8_t *ptr, int16_t n)
+static void encode_fields(const struct codec *codec,
+                          const void *obj,
+                          uint8_t *msg_buf)
 {
-  ptr[0] = n & 0xff;
-  ptr[1] = (n >> 8) & 0xff;
+  const uint8_t *base = obj;
+  const uint8_t *p;
+  uint32_t n;
+  size_t f;
+
+  for (f = 0; f < CODEC_MAX_FIELDS && codec->field[f].width; f++) {
+    p = base + codec->field[f].at;
+    switch (codec->field[f].width) {
+      case 1:
+        msg_buf[0] = *p;
+        break;
+      case 2:
+        n = *(const uint16_t *)p;
+        msg_buf[0] = n & 0xff;
+        msg_buf[1] = (n >> 8) & 0xff;
+        break;
+      case 3:
+        memcpy(msg_buf, p, 3);
+        break;
+      case 4:
+        n = *(const uint32_t *)p;
+        msg_buf[0] = n & 0xff;
+        msg_buf[1] = (n >> 8) & 0xff;
+        msg_buf[2] = (n >> 16) & 0xff;
+        msg_buf[3] = (n >> 24) & 0xff;
+        break;
+    }
+    msg_buf += codec->field[f].width;
+  }
 }
 
-static uint16_t uint16_from_buf(const uint8_t *ptr)
+static void decode_fields(const struct codec *codec,
+                          void *obj,
+                          const uint8_t *msg_buf)
 {
-  return ((uint16_t)ptr[0]) | ((uint16_t)ptr[1] << 8);
+  uint8_t *base = obj;
+  uint8_t *p;
+  size_t f;
+
+  for (f = 0; f < CODEC_MAX_FIELDS && codec->field[f].width; f++) {
+    p = base + codec->field[f].at;
+    switch (codec->field[f].width) {
+      case 1:
+        *p = msg_buf[0];
+        break;
+      case 2:
+        *(uint16_t *)p = ((uint16_t)msg_buf[0]) | ((uint16_t)msg_buf[1] << 8);
+        break;
+      case 3:
+        memcpy(p, msg_buf, 3);
+        break;
+      case 4:
+        *(uint32_t *)p = ((uint32_t)msg_buf[0])
+                         | ((uint32_t)msg_buf[1] << 8)
+                         | ((uint32_t)msg_buf[2] << 16)
+                         | ((uint32_t)msg_buf[3] << 24);
+        break;
+    }
+    msg_buf += codec->field[f].width;
+  }
 }
 
-static void uint16_to_buf(uint8_t *ptr, uint16_t n)
+static uint16_t tail_length(const struct codec *codec, const void *obj)
 {
-  ptr[0] = n & 0xff;
-  ptr[1] = (n >> 8) & 0xff;
+  if (!(codec->flags & CODEC_VALUE)) {
+    return 0;
+  }
+  return *(const uint16_t *)((const uint8_t *)obj + codec->tail.length);
 }
 
-static int32_t int32_from_buf(const uint8_t *ptr)
+static void encode_tail(const struct codec *codec,
+                        const void *obj,
+                        uint8_t *msg_buf)
 {
-  return
-    ((int16_t)ptr[0])
-    | ((int16_t)ptr[1] << 8)
-    | ((int16_t)ptr[2] << 16)
-    | ((int16_t)ptr[3] << 24)
-  ;
+  const uint8_t *base = obj;
+  uint16_t length = tail_length(codec, obj);
+  uint16_t offset;
+  const uint8_t *buffer;
+
+  if (length) {
+    offset = *(const uint16_t *)(base + codec->tail.offset);
+    buffer = *(const uint8_t *const *)(base + codec->tail.buffer);
+    memcpy(msg_buf, buffer + offset, length);
+  }
 }
 
-static void int32_to_buf(uint8_t *ptr, int32_t n)
+/* Points the value at what's left of the message */
+static void decode_tail(const struct codec *codec,
+                        void *obj,
+                        const uint8_t *msg_buf,
+                        size_t msg_off,
+                        size_t msg_len)
 {
-  ptr[0] = n & 0xff;
-  ptr[1] = (n >> 8) & 0xff;
-  ptr[2] = (n >> 16) & 0xff;
-  ptr[3] = (n >> 24) & 0xff;
+  uint8_t *base = obj;
+
+  if (codec->flags & CODEC_VALUE) {
+    *(uint16_t *)(base + codec->tail.length) = msg_len - msg_off;
+    *(uint16_t *)(base + codec->tail.offset) = msg_off;
+    *(const uint8_t **)(base + codec->tail.buffer) = msg_buf;
+  } else if (codec->flags & CODEC_CLEAR) {
+    *(uint16_t *)(base + codec->tail.length) = 0;
+    *(uint16_t *)(base + codec->tail.offset) = 0;
+    *(const uint8_t **)(base + codec->tail.buffer) = NULL;
+  }
 }
 
 int mesh_lib_serialize_request(const struct mesh_generic_request *req,
@@ -55,202 +379,23 @@ int mesh_lib_serialize_request(const struct mesh_generic_request *req,
                                size_t msg_len,
                                size_t *msg_used)
 {
-  size_t msg_off = 0;
-
-  switch (req->kind) {
-    case mesh_generic_request_on_off:
-      if (msg_len < 1) {
-        return -1;
-      }
-      msg_buf[msg_off++] = req->on_off;
-      *msg_used = msg_off;
-      break;
-
-    case mesh_generic_request_on_power_up:
-      if (msg_len < 1) {
-        return -1;
-      }
-      msg_buf[msg_off++] = req->on_power_up;
-      *msg_used = msg_off;
-      break;
-
-    case mesh_generic_request_transition_time:
-      if (msg_len < 1) {
-        return -1;
-      }
-      msg_buf[msg_off++] = req->transition_time;
-      *msg_used = msg_off;
-      break;
-
-    case mesh_generic_request_level:
-    case mesh_generic_request_level_move:
-    case mesh_generic_request_level_halt:
-      if (msg_len < 2) {
-        return -1;
-      }
-      int16_to_buf(&msg_buf[msg_off], req->level);
-      msg_off += 2;
-      *msg_used = msg_off;
-      break;
-
-    case mesh_generic_request_level_delta:
-      if (msg_len < 4) {
-        return -1;
-      }
-      int32_to_buf(&msg_buf[msg_off], req->delta);
-      msg_off += 4;
-      *msg_used = msg_off;
-      break;
-
-    case mesh_generic_request_location_global:
-      if (msg_len < 10) {
-        return -1;
-      }
-      int32_to_buf(&msg_buf[msg_off], req->location_global.lat);
-      msg_off += 4;
-      int32_to_buf(&msg_buf[msg_off], req->location_global.lon);
-      msg_off += 4;
-      int16_to_buf(&msg_buf[msg_off], req->location_global.alt);
-      msg_off += 2;
-      *msg_used = msg_off;
-      break;
-
-    case mesh_generic_request_location_local:
-      if (msg_len < 9) {
-        return -1;
-      }
-      int16_to_buf(&msg_buf[msg_off], req->location_local.north);
-      msg_off += 2;
-      int16_to_buf(&msg_buf[msg_off], req->location_local.east);
-      msg_off += 2;
-      int16_to_buf(&msg_buf[msg_off], req->location_local.alt);
-      msg_off += 2;
-      msg_buf[msg_off++] = req->location_local.floor;
-      uint16_to_buf(&msg_buf[msg_off], req->location_local.uncertainty);
-      msg_off += 2;
-      *msg_used = msg_off;
-      break;
-
-    case mesh_generic_request_power_level:
-    case mesh_generic_request_power_level_default:
-      if (msg_len < 2) {
-        return -1;
-      }
-      uint16_to_buf(&msg_buf[msg_off], req->power_level);
-      msg_off += 2;
-      *msg_used = msg_off;
-      break;
-
-    case mesh_generic_request_power_level_range:
-      if (msg_len < 4) {
-        return -1;
-      }
-      uint16_to_buf(&msg_buf[msg_off], req->power_range[0]);
-      msg_off += 2;
-      uint16_to_buf(&msg_buf[msg_off], req->power_range[1]);
-      msg_off += 2;
-      *msg_used = msg_off;
-      break;
-
-    case mesh_generic_request_property_user:
-      if (msg_len < 2 + req->property.length) {
-        return -1;
-      }
-      uint16_to_buf(&msg_buf[msg_off], req->property.id);
-      msg_off += 2;
-      memcpy(msg_buf + msg_off,
-             req->property.buffer + req->property.offset,
-             req->property.length);
-      msg_off += req->property.length;
-      *msg_used = msg_off;
-      break;
-
-    case mesh_generic_request_property_admin:
-      if (msg_len < 3 + req->property.length) {
-        return -1;
-      }
-      uint16_to_buf(&msg_buf[msg_off], req->property.id);
-      msg_off += 2;
-      msg_buf[msg_off++] = req->property.access;
-      memcpy(msg_buf + msg_off,
-             req->property.buffer + req->property.offset,
-             req->property.length);
-      msg_off += req->property.length;
-      *msg_used = msg_off;
-      break;
-
-    case mesh_generic_request_property_manuf:
-      if (msg_len < 3) {
-        return -1;
-      }
-      uint16_to_buf(&msg_buf[msg_off], req->property.id);
-      msg_off += 2;
-      msg_buf[msg_off++] = req->property.access;
-      *msg_used = msg_off;
-      break;
-
-    case mesh_lighting_request_lightness_actual:
-    case mesh_lighting_request_lightness_linear:
-    case mesh_lighting_request_lightness_default:
-      if (msg_len < 2) {
-        return -1;
-      }
-      uint16_to_buf(&msg_buf[msg_off], req->lightness);
-      msg_off += 2;
-      *msg_used = msg_off;
-      break;
-
-    case mesh_lighting_request_lightness_range:
-      if (msg_len < 4) {
-        return -1;
-      }
-      uint16_to_buf(&msg_buf[msg_off], req->lightness_range.min);
-      msg_off += 2;
-      uint16_to_buf(&msg_buf[msg_off], req->lightness_range.max);
-      msg_off += 2;
-      *msg_used = msg_off;
-      break;
-
-    case mesh_lighting_request_ctl:
-    case mesh_lighting_request_ctl_default:
-      if (msg_len < 6) {
-        return -1;
-      }
-      uint16_to_buf(&msg_buf[msg_off], req->ctl.lightness);
-      msg_off += 2;
-      uint16_to_buf(&msg_buf[msg_off], req->ctl.temperature);
-      msg_off += 2;
-      int16_to_buf(&msg_buf[msg_off], req->ctl.deltauv);
-      msg_off += 2;
-      *msg_used = msg_off;
-      break;
-
-    case mesh_lighting_request_ctl_temperature:
-      if (msg_len < 4) {
-        return -1;
-      }
-      uint16_to_buf(&msg_buf[msg_off], req->ctl_temperature.temperature);
-      msg_off += 2;
-      int16_to_buf(&msg_buf[msg_off], req->ctl_temperature.deltauv);
-      msg_off += 2;
-      *msg_used = msg_off;
-      break;
-
-    case mesh_lighting_request_ctl_temperature_range:
-      if (msg_len < 4) {
-        return -1;
-      }
-      uint16_to_buf(&msg_buf[msg_off], req->ctl_temperature_range.min);
-      msg_off += 2;
-      uint16_to_buf(&msg_buf[msg_off], req->ctl_temperature_range.max);
-      msg_off += 2;
-      *msg_used = msg_off;
-      break;
-
-    default:
-      return -1;
+  const struct codec *codec = find_request_codec(req->kind);
+  size_t size;
+  size_t length;
+
+  if (!codec) {
+    return -1;
+  }
+
+  size = codec_size(codec);
+  length = tail_length(codec, req);
+  if (msg_len < size + length) {
+    return -1;
   }
 
+  encode_fields(codec, req, msg_buf);
+  encode_tail(codec, req, msg_buf + size);
+  *msg_used = size + length;
   return 0;
 }
 
@@ -259,188 +404,21 @@ int mesh_lib_deserialize_request(struct mesh_generic_request *req,
                                  const uint8_t *msg_buf,
                                  size_t msg_len)
 {
-  size_t msg_off = 0;
-
-  switch (kind) {
-    case mesh_generic_request_on_off:
-      if (msg_len - msg_off != 1) {
-        return -1;
-      }
-      req->kind = kind;
-      req->on_off = msg_buf[msg_off];
-      break;
-
-    case mesh_generic_request_on_power_up:
-      if (msg_len - msg_off != 1) {
-        return -1;
-      }
-      req->kind = kind;
-      req->on_power_up = msg_buf[msg_off];
-      break;
-
-    case mesh_generic_request_transition_time:
-      if (msg_len - msg_off != 1) {
-        return -1;
-      }
-      req->kind = kind;
-      req->transition_time = msg_buf[msg_off];
-      break;
-
-    case mesh_generic_request_level:
-    case mesh_generic_request_level_move:
-    case mesh_generic_request_level_halt:
-      if (msg_len - msg_off != 2) {
-        return -1;
-      }
-      req->kind = kind;
-      req->level = int16_from_buf(&msg_buf[msg_off]);
-      break;
-
-    case mesh_generic_request_level_delta:
-      if (msg_len - msg_off != 4) {
-        return -1;
-      }
-      req->kind = kind;
-      req->level = int32_from_buf(&msg_buf[msg_off]);
-      break;
-
-    case mesh_generic_request_location_global:
-      if (msg_len - msg_off != 10) {
-        return -1;
-      }
-      req->kind = kind;
-      req->location_global.lat = int32_from_buf(&msg_buf[msg_off]);
-      msg_off += 4;
-      req->location_global.lon = int32_from_buf(&msg_buf[msg_off]);
-      msg_off += 4;
-      req->location_global.alt = int16_from_buf(&msg_buf[msg_off]);
-      msg_off += 2;
-      break;
-
-    case mesh_generic_request_location_local:
-      if (msg_len - msg_off != 9) {
-        return -1;
-      }
-      req->kind = kind;
-      req->location_local.north = int16_from_buf(&msg_buf[msg_off]);
-      msg_off += 2;
-      req->location_local.east = int16_from_buf(&msg_buf[msg_off]);
-      msg_off += 2;
-      req->location_local.alt = int16_from_buf(&msg_buf[msg_off]);
-      msg_off += 2;
-      req->location_local.floor = msg_buf[msg_off++];
-      req->location_local.uncertainty = uint16_from_buf(&msg_buf[msg_off]);
-      msg_off += 2;
-      break;
-
-    case mesh_generic_request_power_level:
-    case mesh_generic_request_power_level_default:
-      if (msg_len - msg_off != 2) {
-        return -1;
-      }
-      req->kind = kind;
-      req->power_level = uint16_from_buf(&msg_buf[msg_off]);
-      break;
-
-    case mesh_generic_request_power_level_range:
-      if (msg_len - msg_off != 4) {
-        return -1;
-      }
-      req->kind = kind;
-      req->power_range[0] = uint16_from_buf(&msg_buf[msg_off]);
-      req->power_range[1] = uint16_from_buf(&msg_buf[msg_off + 2]);
-      break;
-
-    case mesh_generic_request_property_user:
-      if (msg_len - msg_off < 2) {
-        return -1;
-      }
-      req->kind = kind;
-      req->property.id = uint16_from_buf(&msg_buf[msg_off]);
-      msg_off += 2;
-      req->property.buffer = msg_buf;
-      req->property.offset = msg_off;
-      req->property.length = msg_len - msg_off;
-      break;
-
-    case mesh_generic_request_property_admin:
-      if (msg_len - msg_off < 3) {
-        return -1;
-      }
-      req->kind = kind;
-      req->property.id = uint16_from_buf(&msg_buf[msg_off]);
-      msg_off += 2;
-      req->property.access = msg_buf[msg_off++];
-      req->property.buffer = msg_buf;
-      req->property.offset = msg_off;
-      req->property.length = msg_len - msg_off;
-      break;
-
-    case mesh_generic_request_property_manuf:
-      if (msg_len - msg_off != 3) {
-        return -1;
-      }
-      req->kind = kind;
-      req->property.id = uint16_from_buf(&msg_buf[msg_off]);
-      msg_off += 2;
-      req->property.access = msg_buf[msg_off++];
-      req->property.buffer = NULL;
-      req->property.offset = 0;
-      req->property.length = 0;
-      break;
-
-    case mesh_lighting_request_lightness_actual:
-    case mesh_lighting_request_lightness_linear:
-    case mesh_lighting_request_lightness_default:
-      if (msg_len - msg_off != 2) {
-        return -1;
-      }
-      req->kind = kind;
-      req->lightness = uint16_from_buf(&msg_buf[msg_off]);
-      break;
-
-    case mesh_lighting_request_lightness_range:
-      if (msg_len - msg_off != 4) {
-        return -1;
-      }
-      req->kind = kind;
-      req->lightness_range.min = uint16_from_buf(&msg_buf[msg_off]);
-      req->lightness_range.max = uint16_from_buf(&msg_buf[msg_off + 2]);
-      break;
-
-    case mesh_lighting_request_ctl:
-    case mesh_lighting_request_ctl_default:
-      if (msg_len - msg_off != 6) {
-        return -1;
-      }
-      req->kind = kind;
-      req->ctl.lightness = uint16_from_buf(&msg_buf[msg_off]);
-      req->ctl.temperature = uint16_from_buf(&msg_buf[msg_off + 2]);
-      req->ctl.deltauv = int16_from_buf(&msg_buf[msg_off + 4]);
-      break;
-
-    case mesh_lighting_request_ctl_temperature:
-      if (msg_len - msg_off != 4) {
-        return -1;
-      }
-      req->kind = kind;
-      req->ctl_temperature.temperature = uint16_from_buf(&msg_buf[msg_off]);
-      req->ctl_temperature.deltauv = int16_from_buf(&msg_buf[msg_off + 2]);
-      break;
-
-    case mesh_lighting_request_ctl_temperature_range:
-      if (msg_len - msg_off != 4) {
-        return -1;
-      }
-      req->kind = kind;
-      req->ctl_temperature_range.min = uint16_from_buf(&msg_buf[msg_off]);
-      req->ctl_temperature_range.max = uint16_from_buf(&msg_buf[msg_off + 2]);
-      break;
-
-    default:
-      return -1;
+  const struct codec *codec = find_request_codec(kind);
+  size_t size;
+
+  if (!codec) {
+    return -1;
+  }
+
+  size = codec_size(codec);
+  if (codec_fit(codec, size, msg_len) != 0) {
+    return -1;
   }
 
+  req->kind = kind;
+  decode_fields(codec, req, msg_buf);
+  decode_tail(codec, req, msg_buf, size, msg_len);
   return 0;
 }
 
@@ -450,250 +428,33 @@ int mesh_lib_serialize_state(const struct mesh_generic_state *current,
                              size_t msg_len,
                              size_t *msg_used)
 {
-  size_t msg_off = 0;
-
-  switch (current->kind) {
-    case mesh_generic_state_on_off:
-      if (msg_len < (target ? 2 : 1)) {
-        return -1;
-      }
-      msg_buf[msg_off++] = current->on_off.on;
-      if (target) {
-        msg_buf[msg_off++] = target->on_off.on;
-      }
-      *msg_used = msg_off;
-      break;
-
-    case mesh_generic_state_on_power_up:
-      if (msg_len < 1) {
-        return -1;
-      }
-      msg_buf[msg_off++] = current->on_power_up.on_power_up;
-      *msg_used = msg_off;
-      break;
-
-    case mesh_generic_state_transition_time:
-      if (msg_len < 1) {
-        return -1;
-      }
-      msg_buf[msg_off++] = current->transition_time.time;
-      *msg_used = msg_off;
-      break;
-
-    case mesh_generic_state_level:
-      if (msg_len < (target ? 4 : 2)) {
-        return -1;
-      }
-      int16_to_buf(&msg_buf[msg_off], current->level.level);
-      msg_off += 2;
-      if (target) {
-        int16_to_buf(&msg_buf[msg_off], target->level.level);
-        msg_off += 2;
-      }
-      *msg_used = msg_off;
-      break;
-
-    case mesh_generic_state_location_global:
-      if (msg_len < 10) {
-        return -1;
-      }
-      int32_to_buf(&msg_buf[msg_off], current->location_global.lat);
-      msg_off += 4;
-      int32_to_buf(&msg_buf[msg_off], current->location_global.lon);
-      msg_off += 4;
-      int16_to_buf(&msg_buf[msg_off], current->location_global.alt);
-      msg_off += 2;
-      *msg_used = msg_off;
-      break;
-
-    case mesh_generic_state_location_local:
-      if (msg_len < 9) {
-        return -1;
-      }
-      int16_to_buf(&msg_buf[msg_off], current->location_local.north);
-      msg_off += 2;
-      int16_to_buf(&msg_buf[msg_off], current->location_local.east);
-      msg_off += 2;
-      int16_to_buf(&msg_buf[msg_off], current->location_local.alt);
-      msg_off += 2;
-      msg_buf[msg_off++] = current->location_local.floor;
-      uint16_to_buf(&msg_buf[msg_off], current->location_local.uncertainty);
-      msg_off += 2;
-      *msg_used = msg_off;
-      break;
-
-    case mesh_generic_state_battery:
-      if (msg_len < 8) {
-        return -1;
-      }
-      msg_buf[msg_off++] = current->battery.level;
-      memcpy(msg_buf + msg_off, current->battery.discharge_time, 3);
-      msg_off += 3;
-      memcpy(msg_buf + msg_off, current->battery.charge_time, 3);
-      msg_off += 3;
-      msg_buf[msg_off++] = current->battery.flags;
-      *msg_used = msg_off;
-      break;
-
-    case mesh_generic_state_power_level:
-      if (msg_len < (target ? 4 : 2)) {
-        return -1;
-      }
-      uint16_to_buf(&msg_buf[msg_off], current->power_level.level);
-      msg_off += 2;
-      if (target) {
-        uint16_to_buf(&msg_buf[msg_off], target->power_level.level);
-        msg_off += 2;
-      }
-      *msg_used = msg_off;
-      break;
-
-    case mesh_generic_state_power_level_last:
-      if (msg_len < 2) {
-        return -1;
-      }
-      uint16_to_buf(&msg_buf[msg_off], current->power_level_last.level);
-      msg_off += 2;
-      *msg_used = msg_off;
-      break;
-
-    case mesh_generic_state_power_level_default:
-      if (msg_len < 2) {
-        return -1;
-      }
-      uint16_to_buf(&msg_buf[msg_off], current->power_level_default.level);
-      msg_off += 2;
-      *msg_used = msg_off;
-      break;
-
-    case mesh_generic_state_power_level_range:
-      if (msg_len < 5) {
-        return -1;
-      }
-      msg_buf[msg_off++] = current->power_level_range.status;
-      uint16_to_buf(&msg_buf[msg_off], current->power_level_range.min);
-      msg_off += 2;
-      uint16_to_buf(&msg_buf[msg_off], current->power_level_range.max);
-      msg_off += 2;
-      *msg_used = msg_off;
-      break;
-
-    case mesh_generic_state_property_user:
-    case mesh_generic_state_property_admin:
-    case mesh_generic_state_property_manuf:
-      if (msg_len < 3 + current->property.length) {
-        return -1;
-      }
-      uint16_to_buf(&msg_buf[msg_off], current->property.id);
-      msg_off += 2;
-      msg_buf[msg_off++] = current->property.access;
-      memcpy(msg_buf + msg_off,
-             current->property.buffer + current->property.offset,
-             current->property.length);
-      msg_off += current->property.length;
-      *msg_used = msg_off;
-      break;
-
-    case mesh_generic_state_property_list_user:
-    case mesh_generic_state_property_list_admin:
-    case mesh_generic_state_property_list_manuf:
-    case mesh_generic_state_property_list_client:
-      if (msg_len < current->property_list.length) {
-        return -1;
-      }
-      memcpy(msg_buf + msg_off,
-             current->property_list.buffer + current->property_list.offset,
-             current->property_list.length);
-      msg_off += current->property_list.length;
-      *msg_used = msg_off;
-      break;
-
-    case mesh_lighting_state_lightness_actual:
-    case mesh_lighting_state_lightness_linear:
-      if (msg_len < (target ? 4 : 2)) {
-        return -1;
-      }
-      uint16_to_buf(&msg_buf[msg_off], current->lightness.level);
-      msg_off += 2;
-      if (target) {
-        uint16_to_buf(&msg_buf[msg_off], target->lightness.level);
-        msg_off += 2;
-      }
-      *msg_used = msg_off;
-      break;
-
-    case mesh_lighting_state_lightness_last:
-    case mesh_lighting_state_lightness_default:
-      if (msg_len < 2) {
-        return -1;
-      }
-      uint16_to_buf(&msg_buf[msg_off], current->lightness.level);
-      msg_off += 2;
-      *msg_used = msg_off;
-      break;
-
-    case mesh_lighting_state_lightness_range:
-      if (msg_len < 4) {
-        return -1;
-      }
-      uint16_to_buf(&msg_buf[msg_off], current->lightness_range.min);
-      msg_off += 2;
-      uint16_to_buf(&msg_buf[msg_off], current->lightness_range.max);
-      msg_off += 2;
-      *msg_used = msg_off;
-      break;
-
-    case mesh_lighting_state_ctl:
-    case mesh_lighting_state_ctl_temperature:
-      if (msg_len < (target ? 12 : 6)) {
-        return -1;
-      }
-      uint16_to_buf(&msg_buf[msg_off], current->ctl.lightness);
-      msg_off += 2;
-      uint16_to_buf(&msg_buf[msg_off], current->ctl.temperature);
-      msg_off += 2;
-      int16_to_buf(&msg_buf[msg_off], current->ctl.deltauv);
-      msg_off += 2;
-      if (target) {
-        uint16_to_buf(&msg_buf[msg_off], target->ctl.lightness);
-        msg_off += 2;
-        uint16_to_buf(&msg_buf[msg_off], target->ctl.temperature);
-        msg_off += 2;
-        int16_to_buf(&msg_buf[msg_off], target->ctl.deltauv);
-        msg_off += 2;
-      }
-      *msg_used = msg_off;
-      break;
-
-    case mesh_lighting_state_ctl_default:
-      if (msg_len < 6) {
-        return -1;
-      }
-      uint16_to_buf(&msg_buf[msg_off], current->ctl.lightness);
-      msg_off += 2;
-      uint16_to_buf(&msg_buf[msg_off], current->ctl.temperature);
-      msg_off += 2;
-      int16_to_buf(&msg_buf[msg_off], current->ctl.deltauv);
-      msg_off += 2;
-      *msg_used = msg_off;
-      break;
-
-    case mesh_lighting_state_ctl_temperature_range:
-      if (msg_len < 4) {
-        return -1;
-      }
-      uint16_to_buf(&msg_buf[msg_off], current->ctl_temperature_range.min);
-      msg_off += 2;
-      uint16_to_buf(&msg_buf[msg_off], current->ctl_temperature_range.max);
-      msg_off += 2;
-      *msg_used = msg_off;
-      break;
-
-    case mesh_generic_state_last:
-    default:
-      return -1;
+  const struct codec *codec = find_state_codec(current->kind);
+  size_t size;
+  size_t length;
+
+  if (!codec) {
+    return -1;
+  }
+
+  /* Only some kinds have a target to send */
+  if (!(codec->flags & CODEC_TARGET)) {
+    target = NULL;
+  }
+
+  size = codec_size(codec);
+  length = tail_length(codec, current);
+  if (msg_len < (target ? 2 * size : size + length)) {
+    return -1;
   }
 
+  encode_fields(codec, current, msg_buf);
+  if (target) {
+    encode_fields(codec, target, msg_buf + size);
+    *msg_used = 2 * size;
+  } else {
+    encode_tail(codec, current, msg_buf + size);
+    *msg_used = size + length;
+  }
   return 0;
 }
 
@@ -704,299 +465,77 @@ int mesh_lib_deserialize_state(struct mesh_generic_state *current,
                                const uint8_t *msg_buf,
                                size_t msg_len)
 {
-  size_t msg_off = 0;
-
-  switch (kind) {
-    case mesh_generic_state_on_off:
-      if (msg_len - msg_off == 1) {
-        current->kind = kind;
-        current->on_off.on = msg_buf[msg_off++];
-        *has_target = 0;
-      } else if (msg_len - msg_off == 2) {
-        current->kind = kind;
-        current->on_off.on = msg_buf[msg_off++];
-        target->kind = kind;
-        target->on_off.on = msg_buf[msg_off++];
-        *has_target = 1;
-      } else {
-        return -1;
-      }
-      break;
-
-    case mesh_generic_state_on_power_up:
-      if (msg_len - msg_off == 1) {
-        current->kind = kind;
-        current->on_power_up.on_power_up = msg_buf[msg_off++];
-        *has_target = 0;
-      } else {
-        return -1;
-      }
-      break;
-
-    case mesh_generic_state_transition_time:
-      if (msg_len - msg_off == 1) {
-        current->kind = kind;
-        current->transition_time.time = msg_buf[msg_off++];
-        *has_target = 0;
-      } else {
-        return -1;
-      }
-      break;
-
-    case mesh_generic_state_level:
-      if (msg_len - msg_off == 2) {
-        current->kind = kind;
-        current->level.level = int16_from_buf(&msg_buf[msg_off]);
-        msg_off += 2;
-        *has_target = 0;
-      } else if (msg_len - msg_off == 4) {
-        current->kind = kind;
-        current->level.level = int16_from_buf(&msg_buf[msg_off]);
-        msg_off += 2;
-        target->kind = kind;
-        target->level.level = int16_from_buf(&msg_buf[msg_off]);
-        msg_off += 2;
-        *has_target = 1;
-      } else {
-        return -1;
-      }
-      break;
-
-    case mesh_generic_state_location_global:
-      if (msg_len - msg_off != 10) {
-        return -1;
-      }
-      current->kind = kind;
-      current->location_global.lat = int32_from_buf(&msg_buf[msg_off]);
-      msg_off += 4;
-      current->location_global.lon = int32_from_buf(&msg_buf[msg_off]);
-      msg_off += 4;
-      current->location_global.alt = int16_from_buf(&msg_buf[msg_off]);
-      msg_off += 2;
-      *has_target = 0;
-      break;
-
-    case mesh_generic_state_location_local:
-      if (msg_len - msg_off != 9) {
-        return -1;
-      }
-      current->kind = kind;
-      current->location_local.north = int16_from_buf(&msg_buf[msg_off]);
-      msg_off += 2;
-      current->location_local.east = int16_from_buf(&msg_buf[msg_off]);
-      msg_off += 2;
-      current->location_local.alt = int16_from_buf(&msg_buf[msg_off]);
-      msg_off += 2;
-      current->location_local.floor = msg_buf[msg_off++];
-      current->location_local.uncertainty = uint16_from_buf(&msg_buf[msg_off]);
-      msg_off += 2;
-      *has_target = 0;
-      break;
-
-    case mesh_generic_state_battery:
-      if (msg_len - msg_off != 8) {
-        return -1;
-      }
-      current->battery.level = msg_buf[msg_off++];
-      memcpy(current->battery.discharge_time, msg_buf + msg_off, 3);
-      msg_off += 3;
-      memcpy(current->battery.charge_time, msg_buf + msg_off, 3);
-      msg_off += 3;
-      current->battery.flags = msg_buf[msg_off++];
-      *has_target = 0;
-      break;
-
-    case mesh_generic_state_power_level:
-      if (msg_len - msg_off == 2) {
-        current->kind = kind;
-        current->power_level.level = uint16_from_buf(&msg_buf[msg_off]);
-        msg_off += 2;
-        *has_target = 0;
-      } else if (msg_len - msg_off == 4) {
-        current->kind = kind;
-        current->power_level.level = uint16_from_buf(&msg_buf[msg_off]);
-        msg_off += 2;
-        target->kind = kind;
-        target->power_level.level = uint16_from_buf(&msg_buf[msg_off]);
-        msg_off += 2;
-        *has_target = 1;
-      } else {
-        return -1;
-      }
-      break;
-
-    case mesh_generic_state_power_level_last:
-      if (msg_len - msg_off != 2) {
-        return -1;
-      }
-      current->kind = kind;
-      current->power_level_last.level = uint16_from_buf(&msg_buf[msg_off]);
-      msg_off += 2;
-      *has_target = 0;
-      break;
-
-    case mesh_generic_state_power_level_default:
-      if (msg_len - msg_off != 2) {
-        return -1;
-      }
-      current->kind = kind;
-      current->power_level_default.level = uint16_from_buf(&msg_buf[msg_off]);
-      msg_off += 2;
-      *has_target = 0;
-      break;
-
-    case mesh_generic_state_power_level_range:
-      if (msg_len - msg_off != 5) {
-        return -1;
-      }
-      current->kind = kind;
-      current->power_level_range.status = msg_buf[msg_off++];
-      current->power_level_range.min = uint16_from_buf(&msg_buf[msg_off]);
-      msg_off += 2;
-      current->power_level_range.max = uint16_from_buf(&msg_buf[msg_off]);
-      msg_off += 2;
-      *has_target = 0;
-      break;
-
-    case mesh_generic_state_property_user:
-    case mesh_generic_state_property_admin:
-    case mesh_generic_state_property_manuf:
-      if (msg_len - msg_off < 3) {
-        return -1;
-      }
-      current->kind = kind;
-      current->property.id = uint16_from_buf(&msg_buf[msg_off]);
-      msg_off += 2;
-      current->property.access = msg_buf[msg_off++];
-      current->property.buffer = msg_buf;
-      current->property.offset = msg_off;
-      current->property.length = msg_len - msg_off;
-      *has_target = 0;
-      break;
-
-    case mesh_generic_state_property_list_user:
-    case mesh_generic_state_property_list_admin:
-    case mesh_generic_state_property_list_manuf:
-    case mesh_generic_state_property_list_client:
-      if ((msg_len - msg_off) & 0x01) {
-        return -1;
-      }
-      current->kind = kind;
-      current->property_list.buffer = msg_buf;
-      current->property_list.offset = msg_off;
-      current->property_list.length = msg_len - msg_off;
-      *has_target = 0;
-      break;
-
-    case mesh_lighting_state_lightness_actual:
-    case mesh_lighting_state_lightness_linear:
-      if (msg_len - msg_off == 2) {
-        current->kind = kind;
-        current->lightness.level = uint16_from_buf(&msg_buf[msg_off]);
-        msg_off += 2;
-        *has_target = 0;
-      } else if (msg_len - msg_off == 4) {
-        current->kind = kind;
-        current->lightness.level = int16_from_buf(&msg_buf[msg_off]);
-        msg_off += 2;
-        target->kind = kind;
-        target->lightness.level = int16_from_buf(&msg_buf[msg_off]);
-        msg_off += 2;
-        *has_target = 1;
-      } else {
-        return -1;
-      }
-      break;
-
-    case mesh_lighting_state_lightness_last:
-    case mesh_lighting_state_lightness_default:
-      if (msg_len - msg_off == 2) {
-        current->kind = kind;
-        current->lightness.level = uint16_from_buf(&msg_buf[msg_off]);
-        msg_off += 2;
-        *has_target = 0;
-      } else {
-        return -1;
-      }
-      break;
-
-    case mesh_lighting_state_lightness_range:
-      if (msg_len - msg_off == 4) {
-        current->kind = kind;
-        current->lightness_range.min = uint16_from_buf(&msg_buf[msg_off]);
-        msg_off += 2;
-        current->lightness_range.max = uint16_from_buf(&msg_buf[msg_off]);
-        msg_off += 2;
-        *has_target = 0;
-      } else {
-        return -1;
-      }
-      break;
-
-    case mesh_lighting_state_ctl:
-    case mesh_lighting_state_ctl_temperature:
-      if (msg_len - msg_off == 6) {
-        current->kind = kind;
-        current->ctl.lightness = uint16_from_buf(&msg_buf[msg_off]);
-        msg_off += 2;
-        current->ctl.temperature = uint16_from_buf(&msg_buf[msg_off]);
-        msg_off += 2;
-        current->ctl.deltauv = int16_from_buf(&msg_buf[msg_off]);
-        msg_off += 2;
-        *has_target = 0;
-      } else if (msg_len - msg_off == 12) {
-        current->kind = kind;
-        current->ctl.lightness = int16_from_buf(&msg_buf[msg_off]);
-        msg_off += 2;
-        current->ctl.temperature = uint16_from_buf(&msg_buf[msg_off]);
-        msg_off += 2;
-        current->ctl.deltauv = int16_from_buf(&msg_buf[msg_off]);
-        msg_off += 2;
-        target->kind = kind;
-        target->ctl.lightness = int16_from_buf(&msg_buf[msg_off]);
-        msg_off += 2;
-        target->ctl.temperature = int16_from_buf(&msg_buf[msg_off]);
-        msg_off += 2;
-        target->ctl.deltauv = int16_from_buf(&msg_buf[msg_off]);
-        msg_off += 2;
-        *has_target = 1;
-      } else {
-        return -1;
-      }
-      break;
-
-    case mesh_lighting_state_ctl_default:
-      if (msg_len - msg_off == 6) {
-        current->kind = kind;
-        current->ctl.lightness = uint16_from_buf(&msg_buf[msg_off]);
-        msg_off += 2;
-        current->ctl.temperature = uint16_from_buf(&msg_buf[msg_off]);
-        msg_off += 2;
-        current->ctl.deltauv = int16_from_buf(&msg_buf[msg_off]);
-        msg_off += 2;
-        *has_target = 0;
-      } else {
-        return -1;
-      }
-      break;
-
-    case mesh_lighting_state_ctl_temperature_range:
-      if (msg_len - msg_off == 4) {
-        current->kind = kind;
-        current->ctl_temperature_range.min = uint16_from_buf(&msg_buf[msg_off]);
-        msg_off += 2;
-        current->ctl_temperature_range.max = uint16_from_buf(&msg_buf[msg_off]);
-        msg_off += 2;
-        *has_target = 0;
-      } else {
-        return -1;
-      }
-      break;
-
-    case mesh_generic_state_last:
-    default:
-      return -1;
+  const struct codec *codec = find_state_codec(kind);
+  size_t size;
+  int fit;
+
+  if (!codec) {
+    return -1;
+  }
+
+  size = codec_size(codec);
+  fit = codec_fit(codec, size, msg_len);
+  if (fit < 0) {
+    return -1;
+  }
+
+  current->kind = kind;
+  decode_fields(codec, current, msg_buf);
+  decode_tail(codec, current, msg_buf, size, msg_len);
+  if (fit) {
+    target->kind = kind;
+    decode_fields(codec, target, msg_buf + size);
+  }
+  *has_target = fit;
+  return 0;
+}
+
+int mesh_lib_view_request(struct mesh_lib_view *req,
+                          mesh_generic_request_t kind,
+                          const uint8_t *msg_buf,
+                          size_t msg_len)
+{
+  const struct codec *codec = find_request_codec(kind);
+
+  if (!codec || codec_fit(codec, codec_size(codec), msg_len) != 0) {
+    return -1;
   }
 
+  req->kind = kind;
+  req->buf = msg_buf;
+  req->len = msg_len;
+  return 0;
+}
+
+int mesh_lib_view_state(struct mesh_lib_view *current,
+                        struct mesh_lib_view *target,
+                        int *has_target,
+                        mesh_generic_state_t kind,
+                        const uint8_t *msg_buf,
+                        size_t msg_len)
+{
+  const struct codec *codec = find_state_codec(kind);
+  size_t size;
+  int fit;
+
+  if (!codec) {
+    return -1;
+  }
+
+  size = codec_size(codec);
+  fit = codec_fit(codec, size, msg_len);
+  if (fit < 0) {
+    return -1;
+  }
+
+  current->kind = kind;
+  current->buf = msg_buf;
+  current->len = fit ? size : msg_len;
+  if (fit) {
+    target->kind = kind;
+    target->buf = msg_buf + size;
+    target->len = size;
+  }
+  *has_target = fit;
   return 0;
 }
@@ -0,0 +1,335 @@
+/*
+ * @file calib_module.c
+ * @brief Calibration Module. Turns raw soil probe counts into volumetric water content
+ *     using a per-probe piecewise linear curve kept in flash.
+ *
+ * @author agent
+ * @date Oct 15, 2026
+ */
+
+/* Standard Libraries */
+#include "stdint.h"
+#include "stdbool.h"
+#include "stdlib.h"
+#include "string.h"
+
+/* Bluetooth stack headers */
+#include "bg_types.h"
+#include "native_gecko.h"
+
+#include "calib_module.h"
+#include "settings_module.h"
+
+#include "debug.h"
+
+/*
+ * Everything is 16 bits wide, so there's no padding in the flash copy. Only the first count points
+ * are meaningful, but the whole thing is saved so the record is always the same size.
+ */
+typedef struct {
+	uint16_t count;
+	calib_point points[CALIB_MAX_POINTS];
+} calib_curve;
+
+static calib_curve curves[SOIL_PROBE_COUNT];
+/* Whether each probe is still on the placeholder curve (which never goes to flash) */
+static bool uncalibrated[SOIL_PROBE_COUNT];
+
+static void _load_default(uint8_t probe);
+static bool _migrate(uint8_t version, const uint8_t *old, uint8_t len, void *data);
+static void _save(uint8_t probe);
+static bool _is_valid(const calib_curve *curve);
+static uint16_t _interpolate(int32_t x0, int32_t y0, int32_t x1, int32_t y1, int32_t x);
+
+/*
+ * @brief Loads every probe's curve from flash, falling back to the default curve for any that are missing or damaged.
+ *
+ * @return void
+ */
+void calib_load() {
+	uint8_t probe;
+
+	for (probe = 0; probe < SOIL_PROBE_COUNT; ++probe) {
+		settings_register(CALIB_FLASH_KEY_BASE + probe, CALIB_VERSION, &curves[probe], sizeof(calib_curve), _migrate);
+
+		/* Only take it if it makes sense */
+		if (settings_load(CALIB_FLASH_KEY_BASE + probe) && _is_valid(&curves[probe])) {
+			uncalibrated[probe] = false;
+			debug_log("Loaded %d point calibration for probe %d.", curves[probe].count, probe);
+			continue;
+		}
+
+		debug_log("No usable calibration for probe %d. Using the default.", probe);
+		_load_default(probe);
+	}
+}
+
+/*
+ * @brief Converts a raw probe reading to volumetric water content.
+ *
+ * @param probe Which probe the reading came from.
+ * @param counts The raw 12 bit reading.
+ *
+ * @return The water content in 0.01 % units. 0 for an unknown probe.
+ */
+uint16_t calib_to_vwc(uint8_t probe, uint16_t counts) {
+	const calib_point *points;
+	uint16_t count;
+	uint8_t i;
+
+	if (probe >= SOIL_PROBE_COUNT) {
+		return 0;
+	}
+	points = curves[probe].points;
+	count = curves[probe].count;
+
+	/* Off the dry end */
+	if (counts <= points[0].counts) {
+		return points[0].vwc;
+	}
+
+	/* Find the segment we're in */
+	for (i = 1; i < count; ++i) {
+		if (counts <= points[i].counts) {
+			return _interpolate(points[i - 1].counts, points[i - 1].vwc, points[i].counts, points[i].vwc, counts);
+		}
+	}
+
+	/* Off the wet end */
+	return points[count - 1].vwc;
+}
+
+/*
+ * @brief Converts a volumetric water content back to the raw reading that would produce it.
+ *
+ * Useful for turning VWC thresholds into something the ADC can compare against. If the curve
+ * isn't monotonic, the first (driest) match wins.
+ *
+ * @param probe Which probe the threshold is for.
+ * @param vwc The water content in 0.01 % units.
+ *
+ * @return The raw 12 bit reading. Clamped to the nearer end of the curve if it never reaches vwc.
+ */
+uint16_t calib_from_vwc(uint8_t probe, uint16_t vwc) {
+	const calib_point *points;
+	uint16_t count;
+	uint8_t i;
+	uint16_t low;
+	uint16_t high;
+
+	if (probe >= SOIL_PROBE_COUNT) {
+		return 0;
+	}
+	points = curves[probe].points;
+	count = curves[probe].count;
+
+	for (i = 1; i < count; ++i) {
+		low = (points[i - 1].vwc < points[i].vwc) ? points[i - 1].vwc : points[i].vwc;
+		high = (points[i - 1].vwc < points[i].vwc) ? points[i].vwc : points[i - 1].vwc;
+		if (vwc < low || vwc > high) {
+			continue;
+		}
+		/* A flat segment; anywhere on it will do */
+		if (low == high) {
+			return points[i - 1].counts;
+		}
+		return _interpolate(points[i - 1].vwc, points[i - 1].counts, points[i].vwc, points[i].counts, vwc);
+	}
+
+	/* Never got there; take whichever end is closer */
+	if (abs((int32_t) vwc - points[0].vwc) <= abs((int32_t) vwc - points[count - 1].vwc)) {
+		return points[0].counts;
+	}
+	return points[count - 1].counts;
+}
+
+/*
+ * @brief Copies out a probe's calibration points.
+ *
+ * @param probe Which probe to get the curve for.
+ * @param points Where to put the points. Must have room for CALIB_MAX_POINTS.
+ *
+ * @return How many points were copied. 0 for an unknown probe.
+ */
+uint8_t calib_get_points(uint8_t probe, calib_point *points) {
+	if (probe >= SOIL_PROBE_COUNT) {
+		return 0;
+	}
+
+	memcpy(points, curves[probe].points, curves[probe].count * sizeof(calib_point));
+	return curves[probe].count;
+}
+
+/*
+ * @brief Adds a calibration point to a probe's curve (or moves the one already at those counts) and saves it.
+ *
+ * The default curve is replaced by the first point set on a probe, so a probe calibrated with a
+ * single point reads that VWC everywhere until it gets a second.
+ *
+ * @param probe Which probe to calibrate.
+ * @param counts The raw reading the probe gave.
+ * @param vwc The water content it was actually in, 0.01 %. Clamped to CALIB_MAX_VWC.
+ *
+ * @return True if the point was stored. False for an unknown probe or a full curve.
+ */
+bool calib_set_point(uint8_t probe, uint16_t counts, uint16_t vwc) {
+	calib_curve *curve;
+	uint8_t i;
+
+	if (probe >= SOIL_PROBE_COUNT) {
+		return false;
+	}
+	curve = &curves[probe];
+
+	if (vwc > CALIB_MAX_VWC) {
+		vwc = CALIB_MAX_VWC;
+	}
+
+	/* The default curve is just a placeholder; the first real point starts a new one */
+	if (uncalibrated[probe]) {
+		curve->points[0].counts = counts;
+		curve->points[0].vwc = vwc;
+		curve->count = 1;
+		uncalibrated[probe] = false;
+		_save(probe);
+		return true;
+	}
+
+	/* Find where it goes */
+	for (i = 0; i < curve->count && curve->points[i].counts < counts; ++i) {
+	}
+
+	if (i < curve->count && curve->points[i].counts == counts) {
+		/* Already have a point there; just move it */
+		curve->points[i].vwc = vwc;
+	} else {
+		if (curve->count >= CALIB_MAX_POINTS) {
+			return false;
+		}
+		/* Make room and slot it in */
+		memmove(&curve->points[i + 1], &curve->points[i], (curve->count - i) * sizeof(calib_point));
+		curve->points[i].counts = counts;
+		curve->points[i].vwc = vwc;
+		++curve->count;
+	}
+
+	_save(probe);
+	return true;
+}
+
+/*
+ * @brief Throws away a probe's calibration and goes back to the default curve.
+ *
+ * The next calib_set_point on the probe starts a fresh curve.
+ *
+ * @param probe Which probe to reset.
+ *
+ * @return True if the probe was reset. False for an unknown probe.
+ */
+bool calib_reset(uint8_t probe) {
+	if (probe >= SOIL_PROBE_COUNT) {
+		return false;
+	}
+
+	/* Nothing stored means default, so just forget what we had */
+	settings_erase(CALIB_FLASH_KEY_BASE + probe);
+	_load_default(probe);
+	return true;
+}
+
+/*
+ * @brief Puts the default curve in place for a probe.
+ *
+ * The default is marked as uncalibrated so that the first point set remotely replaces it
+ * rather than being mixed into it.
+ *
+ * @param probe Which probe to reset.
+ *
+ * @return void
+ */
+static void _load_default(uint8_t probe) {
+	memset(&curves[probe], 0, sizeof(calib_curve));
+	curves[probe].points[0].counts = CALIB_DEFAULT_DRY_COUNTS;
+	curves[probe].points[0].vwc = CALIB_DEFAULT_DRY_VWC;
+	curves[probe].points[1].counts = CALIB_DEFAULT_WET_COUNTS;
+	curves[probe].points[1].vwc = CALIB_DEFAULT_WET_VWC;
+	curves[probe].count = 2;
+	uncalibrated[probe] = true;
+}
+
+/*
+ * @brief Has a probe's curve saved once the changes stop coming, so a whole calibration session is one write.
+ *
+ * @param probe Which probe's curve to save.
+ *
+ * @return void
+ */
+static void _save(uint8_t probe) {
+	settings_mark_dirty(CALIB_FLASH_KEY_BASE + probe);
+}
+
+/*
+ * @brief Brings a curve saved by an older version forward.
+ *
+ * Before the settings store, curves were saved raw, in the same layout.
+ *
+ * @param version The version of the old curve.
+ * @param old The old curve.
+ * @param len How long the old curve is.
+ * @param data The curve to fill in.
+ *
+ * @return True if the old curve could be used.
+ */
+static bool _migrate(uint8_t version, const uint8_t *old, uint8_t len, void *data) {
+	if (version == 0 && len == sizeof(calib_curve)) {
+		memcpy(data, old, sizeof(calib_curve));
+		return true;
+	}
+	return false;
+}
+
+/*
+ * @brief Checks that a curve loaded from flash is usable.
+ *
+ * @param curve The curve to check.
+ *
+ * @return True if it has between 1 and CALIB_MAX_POINTS points in strictly increasing order.
+ */
+static bool _is_valid(const calib_curve *curve) {
+	uint8_t i;
+
+	if (curve->count < 1 || curve->count > CALIB_MAX_POINTS) {
+		return false;
+	}
+	for (i = 1; i < curve->count; ++i) {
+		if (curve->points[i].counts <= curve->points[i - 1].counts) {
+			return false;
+		}
+	}
+	return true;
+}
+
+/*
+ * @brief Linear interpolation in integer math, rounded to nearest.
+ *
+ * @param x0 The start of the segment.
+ * @param y0 The value at the start of the segment.
+ * @param x1 The end of the segment. Must differ from x0.
+ * @param y1 The value at the end of the segment.
+ * @param x Where to evaluate. Expected to be between x0 and x1.
+ *
+ * @return The value at x.
+ */
+static uint16_t _interpolate(int32_t x0, int32_t y0, int32_t x1, int32_t y1, int32_t x) {
+	int32_t num = (x - x0) * (y1 - y0);
+	int32_t den = x1 - x0;
+
+	/* Nudge by half the divisor in the direction of the result so the divide rounds instead of truncating */
+	if ((num < 0) != (den < 0)) {
+		num -= abs(den) / 2;
+	} else {
+		num += abs(den) / 2;
+	}
+
+	return (uint16_t) (y0 + num / den);
+}
@@ -0,0 +1,50 @@
+/*
+ * @file calib_module.h
+ * @brief Calibration Module. Turns raw soil probe counts into volumetric water content
+ *     using a per-probe piecewise linear curve kept in flash.
+ *
+ * @author agent
+ * @date Oct 15, 2026
+ */
+
+#ifndef SRC_CALIB_MODULE_H_
+#define SRC_CALIB_MODULE_H_
+
+#include "stdint.h"
+#include "stdbool.h"
+
+#include "soil_driver_bt.h"
+
+/*
+ * Each probe gets up to CALIB_MAX_POINTS (counts, VWC) pairs, kept sorted by counts. Readings between
+ * points are interpolated, and readings past either end are clamped to that end's VWC. VWC is in
+ * hundredths of a percent (0 to 10000). Each curve lives on its own PS key, starting at CALIB_FLASH_KEY_BASE,
+ * and is written through the settings store.
+ */
+#define CALIB_MAX_POINTS (8)
+#define CALIB_FLASH_KEY_BASE (0x4010)
+#define CALIB_VERSION (1) /* Of the saved curve's layout */
+#define CALIB_MAX_VWC (10000) /* 0.01 % */
+
+/*
+ * Until a probe is calibrated, a rough curve for our test sand is used: bone dry reads around 0x0400,
+ * and soaked (about 45 % VWC) reads around 0x0D14.
+ */
+#define CALIB_DEFAULT_DRY_COUNTS (0x0400)
+#define CALIB_DEFAULT_DRY_VWC (0)
+#define CALIB_DEFAULT_WET_COUNTS (0x0D14)
+#define CALIB_DEFAULT_WET_VWC (4500)
+
+typedef struct {
+	uint16_t counts; /* Raw 12 bit probe reading */
+	uint16_t vwc; /* The water content it means, 0.01 % */
+} calib_point;
+
+void calib_load();
+uint16_t calib_to_vwc(uint8_t probe, uint16_t counts);
+uint16_t calib_from_vwc(uint8_t probe, uint16_t vwc);
+uint8_t calib_get_points(uint8_t probe, calib_point *points);
+bool calib_set_point(uint8_t probe, uint16_t counts, uint16_t vwc);
+bool calib_reset(uint8_t probe);
+
+#endif /* SRC_CALIB_MODULE_H_ */
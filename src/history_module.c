@@ -0,0 +1,124 @@
+/*
+ * @file history_module.c
+ * @brief History Module. Keeps the recent readings in RAM, with timestamps, and queues up the
+ *     ones that couldn't be delivered so they can be sent later.
+ *
+ * @author agent
+ * @date Oct 15, 2026
+ */
+
+/* Standard Libraries */
+#include "stdint.h"
+#include "stdbool.h"
+
+/* Bluetooth stack headers */
+#include "bg_types.h"
+#include "native_gecko.h"
+
+#include "history_module.h"
+
+#include "debug.h"
+
+/* The ring: head is the oldest entry */
+static history_entry entries[HISTORY_DEPTH];
+static uint8_t head = 0;
+static uint8_t count = 0;
+static uint8_t pending_count = 0;
+
+static history_entry *_get_entry(uint8_t index);
+
+/*
+ * @brief Gets an entry by how far it is from the oldest.
+ *
+ * @param index 0 for the oldest entry, count - 1 for the newest.
+ *
+ * @return The entry.
+ */
+static history_entry *_get_entry(uint8_t index) {
+	return &entries[(head + index) % HISTORY_DEPTH];
+}
+
+/*
+ * @brief Records a reading, dropping the oldest one if the history is full.
+ *
+ * @param probe Which probe the reading came from.
+ * @param vwc The reading, in 0.01 % VWC.
+ * @param pending Whether the reading still needs to be delivered.
+ *
+ * @return void
+ */
+void history_add(uint8_t probe, uint16_t vwc, bool pending) {
+	history_entry *entry;
+
+	if (count == HISTORY_DEPTH) {
+		/* Out of room; the oldest goes, whether it was delivered or not */
+		if (_get_entry(0)->pending) {
+			--pending_count;
+			debug_log("History full. Dropped an undelivered reading.");
+		}
+		head = (head + 1) % HISTORY_DEPTH;
+		--count;
+	}
+
+	entry = _get_entry(count);
+	entry->time = gecko_cmd_hardware_get_time()->seconds;
+	entry->vwc = vwc;
+	entry->probe = probe;
+	entry->pending = pending;
+	++count;
+
+	if (pending) {
+		++pending_count;
+	}
+}
+
+/*
+ * @brief Copies out the oldest readings that still need to be delivered.
+ *
+ * @param out Where to put them. Needs room for max entries.
+ * @param max The most to copy.
+ *
+ * @return How many were copied, oldest first.
+ */
+uint8_t history_get_pending(history_entry *out, uint8_t max) {
+	uint8_t found = 0;
+	uint8_t i;
+
+	for (i = 0; i < count && found < max; ++i) {
+		if (_get_entry(i)->pending) {
+			out[found++] = *_get_entry(i);
+		}
+	}
+
+	return found;
+}
+
+/*
+ * @brief Marks the oldest undelivered readings as delivered.
+ *
+ * Meant to be called with however many history_get_pending handed out once they've gone out.
+ *
+ * @param sent How many readings were delivered.
+ *
+ * @return void
+ */
+void history_mark_sent(uint8_t sent) {
+	uint8_t i;
+
+	for (i = 0; i < count && sent > 0; ++i) {
+		if (_get_entry(i)->pending) {
+			_get_entry(i)->pending = false;
+			--pending_count;
+			--sent;
+		}
+	}
+}
+
+/*
+ * @brief Gets how many readings still need to be delivered.
+ *
+ * @return The number of undelivered readings.
+ */
+uint8_t history_count_pending() {
+	return pending_count;
+}
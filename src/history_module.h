@@ -0,0 +1,36 @@
+/*
+ * @file history_module.h
+ * @brief History Module. Keeps the recent readings in RAM, with timestamps, and queues up the
+ *     ones that couldn't be delivered so they can be sent later.
+ *
+ * @author agent
+ * @date Oct 15, 2026
+ */
+
+#ifndef SRC_HISTORY_MODULE_H_
+#define SRC_HISTORY_MODULE_H_
+
+#include "stdint.h"
+#include "stdbool.h"
+
+/*
+ * How many readings to remember, across all probes. Once it's full the oldest reading is dropped,
+ * delivered or not, so this also bounds how long an outage we can cover: 64 readings is about 5
+ * minutes of every reading at MEASUREMENT_MIN_TIME, and a lot longer when the readings are steady
+ * or only the ones the cadence would have published are queued.
+ */
+#define HISTORY_DEPTH (64)
+
+typedef struct {
+	uint32_t time; /* s since boot */
+	uint16_t vwc; /* 0.01 % */
+	uint8_t probe;
+	bool pending; /* Still needs to be delivered */
+} history_entry;
+
+void history_add(uint8_t probe, uint16_t vwc, bool pending);
+uint8_t history_get_pending(history_entry *entries, uint8_t max);
+void history_mark_sent(uint8_t count);
+uint8_t history_count_pending();
+
+#endif /* SRC_HISTORY_MODULE_H_ */
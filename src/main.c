@@ -31,6 +31,8 @@
 #include "gatt_db.h"
 #include <gecko_configuration.h>
 #include <mesh_sizes.h>
+#include <mesh_generic_model_capi_types.h>
+#include <mesh_lib.h>
 
 /* Libraries containing default Gecko configuration values */
 #include "em_emu.h"
@@ -56,6 +58,11 @@
 #include "src/pb_driver_bt.h"
 #include <src/meshconn_module.h>
 #include <src/moistsrv_module.h>
+#include <src/moistcfg_module.h>
+#include <src/moistsens_module.h>
+#include <src/settings_module.h>
+#include <src/valve_module.h>
+#include <src/router_module.h>
 
 
 /***********************************************************************************************//**
@@ -109,7 +116,22 @@ const gecko_configuration_t config =
 };
 
 static void _handle_gecko_event(uint32_t evt_id, struct gecko_cmd_packet *evt);
+static void _subscribe_handlers();
 static void _start_radio_stack();
+
+/* What _handle_gecko_event handles */
+static const uint32_t subscribed_events[] = {
+		gecko_evt_dfu_boot_id,
+		gecko_evt_le_connection_closed_id,
+		gecko_evt_gatt_server_user_write_request_id
+};
+
+static const router_subscription main_subscription = {
+		_handle_gecko_event,
+		subscribed_events, ROUTER_COUNT(subscribed_events),
+		NULL, 0,
+		0
+};
 // void mesh_native_bgapi_init(void);
 bool mesh_bgapi_listener(struct gecko_cmd_packet *evt);
 
@@ -161,6 +183,8 @@ static void _start_radio_stack() {
 	gecko_bgapi_class_sm_init();
 	gecko_bgapi_class_mesh_node_init();
 	gecko_bgapi_class_mesh_generic_server_init();
+	gecko_bgapi_class_mesh_generic_client_init();
+	gecko_bgapi_class_mesh_vendor_model_init();
 	gecko_bgapi_class_mesh_proxy_server_init();
 	gecko_bgapi_class_mesh_proxy_init();
 	gecko_bgapi_class_mesh_lpn_init();
@@ -175,16 +199,48 @@ static void _start_radio_stack() {
 	/* Initialize our mesh connection library */
 	meshconn_init();
 
+	/* Set up who gets which events */
+	_subscribe_handlers();
+
 	/* Main Loop */
 	while (1) {
-		struct gecko_cmd_packet *evt = gecko_wait_event();
+		struct gecko_cmd_packet *evt = gecko_peek_event();
+		if (evt == NULL) {
+			/* The queue's dry; hand over any state changes mesh_lib held back, then sleep until there's more */
+			mesh_lib_generic_server_flush();
+			evt = gecko_wait_event();
+		}
 		bool pass = mesh_bgapi_listener(evt);
 		if (pass) {
 			/* if the BGAPI tells us it's a message we need to handle, pass it on to the handlers in our various modules */
 			debug_log("EVENT: %08lX", evt->header);
-			_handle_gecko_event(BGLIB_MSG_ID(evt->header), evt);
-			meshconn_handle_events(BGLIB_MSG_ID(evt->header), evt);
-			moistsrv_handle_events(BGLIB_MSG_ID(evt->header), evt);
+			router_dispatch(evt);
+		}
+	}
+}
+
+/*
+ * @brief Subscribes each module's event handler to the events it handles. They're called in this
+ * order, same as they always were.
+ *
+ * @return void
+ */
+static void _subscribe_handlers() {
+	const router_subscription *subscriptions[] = {
+			&main_subscription,
+			&meshconn_subscription,
+			&moistsrv_subscription,
+			&moistcfg_subscription,
+			&moistsens_subscription,
+			&settings_subscription,
+			&valve_subscription
+	};
+	uint8_t i;
+
+	router_init();
+	for (i = 0; i < ROUTER_COUNT(subscriptions); ++i) {
+		if (!router_subscribe(subscriptions[i])) {
+			debug_log("Failed to subscribe event handler %d.", i);
 		}
 	}
 }
@@ -200,6 +256,8 @@ static void _handle_gecko_event(uint32_t evt_id, struct gecko_cmd_packet *evt)
     case gecko_evt_le_connection_closed_id:
       /* Check if need to boot to dfu mode */
       if (boot_to_dfu) {
+        /* Don't lose any settings still waiting to be written */
+        settings_flush();
         /* Enter to DFU OTA mode */
         gecko_cmd_system_reset(2);
       }
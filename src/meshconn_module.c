@@ -406,3 +406,28 @@ void meshconn_handle_events(uint32_t evt_id, struct gecko_cmd_packet *evt) {
 			break;
 	}
 }
+
+/* What meshconn_handle_events handles, so the router only hands it those */
+static const uint32_t subscribed_events[] = {
+		gecko_evt_system_boot_id,
+		gecko_evt_mesh_node_initialized_id,
+		gecko_evt_mesh_node_provisioning_started_id,
+		gecko_evt_mesh_node_static_oob_request_id,
+		gecko_evt_mesh_node_display_output_oob_id,
+		gecko_evt_mesh_node_provisioning_failed_id,
+		gecko_evt_mesh_node_provisioned_id,
+		gecko_evt_mesh_node_reset_id,
+		gecko_evt_le_connection_opened_id,
+		gecko_evt_le_connection_closed_id
+};
+static const uint8_t subscribed_timers[] = {
+		BLINK_TIMER_HANDLE,
+		REBOOT_TIMER_HANDLE
+};
+
+const router_subscription meshconn_subscription = {
+		meshconn_handle_events,
+		subscribed_events, ROUTER_COUNT(subscribed_events),
+		subscribed_timers, ROUTER_COUNT(subscribed_timers),
+		CORE_EVT_BOOT | CORE_EVT_NETWORK_READY
+};
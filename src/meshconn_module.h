@@ -12,6 +12,8 @@
 #include "stdint.h"
 #include "native_gecko.h"
 
+#include "router_module.h"
+
 #define MESH_STATIC_KEY {0x12,0x34}
 
 #define MESHCONN_TIMER_HANDLE_BASE (0)
@@ -35,4 +37,6 @@ meshconn_states meshconn_get_state();
 void meshconn_init();
 void meshconn_handle_events(uint32_t evt_id, struct gecko_cmd_packet *evt);
 
+extern const router_subscription meshconn_subscription;
+
 #endif /* SRC_MESHCONN_MODULE_H_ */
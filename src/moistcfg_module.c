@@ -0,0 +1,259 @@
+/*
+ * @file moistcfg_module.c
+ * @brief Moisture Configuration Module. A vendor model that lets the gateway
+ *     configure the sensor remotely.
+ *
+ * @author agent
+ * @date Oct 15, 2026
+ */
+
+/* Standard Libraries */
+#include "stdint.h"
+#include "stdbool.h"
+
+/* Bluetooth stack headers */
+#include "bg_types.h"
+#include "native_gecko.h"
+
+#include "moistcfg_module.h"
+#include "calib_module.h"
+#include "moistsrv_module.h"
+
+#include "debug.h"
+#include "user_signals_bt.h"
+
+/* Room for the largest status we send: a full calibration curve */
+#define MOISTCFG_MAX_PAYLOAD (3 + (CALIB_MAX_POINTS * 4))
+
+static const uint8_t opcodes[] = {
+		MOISTCFG_OP_CALIB_GET,
+		MOISTCFG_OP_CALIB_SET,
+		MOISTCFG_OP_CALIB_RESET,
+		MOISTCFG_OP_CALIB_STATUS,
+		MOISTCFG_OP_PARAM_GET,
+		MOISTCFG_OP_PARAM_SET,
+		MOISTCFG_OP_PARAM_STATUS
+};
+
+static void _init_model();
+static void _handle_message(const struct gecko_msg_mesh_vendor_model_receive_evt_t *msg);
+static void _send_calib_status(const struct gecko_msg_mesh_vendor_model_receive_evt_t *msg, uint8_t probe, uint8_t status);
+static void _send_param_status(const struct gecko_msg_mesh_vendor_model_receive_evt_t *msg, uint8_t param, uint8_t status);
+static void _send(const struct gecko_msg_mesh_vendor_model_receive_evt_t *msg, uint8_t opcode, uint8_t len, const uint8_t *payload);
+static uint16_t _get_uint16(const uint8_t *data);
+static void _put_uint16(uint8_t *data, uint16_t value);
+
+/*
+ * @brief Brings the vendor model online. Should be done once the node is provisioned.
+ *
+ * @return void
+ */
+static void _init_model() {
+	DEBUG_ASSERT_BGAPI_SUCCESS(
+			gecko_cmd_mesh_vendor_model_init(MOISTCFG_ELEMENT_INDEX, MOISTCFG_VENDOR_ID, MOISTCFG_MODEL_ID,
+					true, sizeof(opcodes), opcodes)
+			->result, "Failed to init configuration model.");
+	debug_log("Configuration model ready.");
+}
+
+/*
+ * @brief Acts on a message sent to our vendor model.
+ *
+ * @param msg The message as the BGAPI gave it to us.
+ *
+ * @return void
+ */
+static void _handle_message(const struct gecko_msg_mesh_vendor_model_receive_evt_t *msg) {
+	const uint8_t *data = msg->payload.data;
+	uint8_t len = msg->payload.len;
+	uint8_t status = MOISTCFG_STATUS_REJECTED;
+
+	/* Everything we understand starts with the probe or parameter */
+	if (len < 1) {
+		return;
+	}
+
+	switch (msg->opcode) {
+		case MOISTCFG_OP_PARAM_GET:
+			_send_param_status(msg, data[0], MOISTCFG_STATUS_OK);
+			return;
+		case MOISTCFG_OP_PARAM_SET:
+			if (len >= 5 && moistsrv_set_param(data[0], _get_uint16(&data[1]) | ((uint32_t) _get_uint16(&data[3]) << 16))) {
+				status = MOISTCFG_STATUS_OK;
+			}
+			debug_log("Parameter 0x%02X set: %d", data[0], status);
+			_send_param_status(msg, data[0], status);
+			return;
+		case MOISTCFG_OP_CALIB_GET:
+			if (data[0] < SOIL_PROBE_COUNT) {
+				status = MOISTCFG_STATUS_OK;
+			}
+			break;
+		case MOISTCFG_OP_CALIB_SET:
+			if (len >= 5 && calib_set_point(data[0], _get_uint16(&data[1]), _get_uint16(&data[3]))) {
+				status = MOISTCFG_STATUS_OK;
+			}
+			debug_log("Calibration point for probe %d: 0x%04X is %d", data[0], _get_uint16(&data[1]), _get_uint16(&data[3]));
+			break;
+		case MOISTCFG_OP_CALIB_RESET:
+			if (calib_reset(data[0])) {
+				status = MOISTCFG_STATUS_OK;
+			}
+			break;
+		default:
+			/* Statuses (and anything else) aren't for us */
+			return;
+	}
+
+	_send_calib_status(msg, data[0], status);
+}
+
+/*
+ * @brief Answers a request with the current calibration curve for a probe.
+ *
+ * @param msg The request we're answering.
+ * @param probe The probe the request was about.
+ * @param status Whether the request was carried out.
+ *
+ * @return void
+ */
+static void _send_calib_status(const struct gecko_msg_mesh_vendor_model_receive_evt_t *msg, uint8_t probe, uint8_t status) {
+	uint8_t payload[MOISTCFG_MAX_PAYLOAD];
+	calib_point points[CALIB_MAX_POINTS];
+	uint8_t count;
+	uint8_t i;
+
+	count = calib_get_points(probe, points);
+
+	payload[0] = probe;
+	payload[1] = status;
+	payload[2] = count;
+	for (i = 0; i < count; ++i) {
+		_put_uint16(&payload[3 + (i * 4)], points[i].counts);
+		_put_uint16(&payload[5 + (i * 4)], points[i].vwc);
+	}
+
+	_send(msg, MOISTCFG_OP_CALIB_STATUS, 3 + (count * 4), payload);
+}
+
+/*
+ * @brief Answers a request with the current value of a parameter.
+ *
+ * @param msg The request we're answering.
+ * @param param The parameter the request was about.
+ * @param status Whether the request was carried out.
+ *
+ * @return void
+ */
+static void _send_param_status(const struct gecko_msg_mesh_vendor_model_receive_evt_t *msg, uint8_t param, uint8_t status) {
+	uint8_t payload[6];
+	uint32_t value = 0;
+
+	/* If it isn't there at all, say so instead */
+	if (!moistsrv_get_param(param, &value)) {
+		status = MOISTCFG_STATUS_UNKNOWN;
+	}
+
+	payload[0] = param;
+	payload[1] = status;
+	_put_uint16(&payload[2], value & 0xFFFF);
+	_put_uint16(&payload[4], value >> 16);
+
+	_send(msg, MOISTCFG_OP_PARAM_STATUS, sizeof(payload), payload);
+}
+
+/*
+ * @brief Sends a status back to whoever sent a request.
+ *
+ * @param msg The request we're answering.
+ * @param opcode The status opcode.
+ * @param len How long the status is.
+ * @param payload The status.
+ *
+ * @return void
+ */
+static void _send(const struct gecko_msg_mesh_vendor_model_receive_evt_t *msg, uint8_t opcode, uint8_t len, const uint8_t *payload) {
+	errorcode_t result;
+
+	result = gecko_cmd_mesh_vendor_model_send(
+			msg->elem_index,
+			MOISTCFG_VENDOR_ID,
+			MOISTCFG_MODEL_ID,
+			msg->source_address,
+			msg->va_index,
+			msg->appkey_index,
+			msg->nonrelayed,
+			opcode,
+			true,
+			len,
+			payload)->result;
+
+	debug_log("Configuration status 0x%02X sent. Result: 0x%04X", opcode, result);
+}
+
+/*
+ * @brief Reads a little endian 16 bit value out of a message.
+ *
+ * @param data Where the value starts.
+ *
+ * @return The value.
+ */
+static uint16_t _get_uint16(const uint8_t *data) {
+	return (uint16_t) (data[0] | (data[1] << 8));
+}
+
+/*
+ * @brief Writes a little endian 16 bit value into a message.
+ *
+ * @param data Where the value should go.
+ * @param value The value.
+ *
+ * @return void
+ */
+static void _put_uint16(uint8_t *data, uint16_t value) {
+	data[0] = value & 0xFF;
+	data[1] = value >> 8;
+}
+
+/*
+ * @brief Responds to events generated by the BGAPI message queue
+ * that are related to the configuration module.
+ *
+ * @param evt_id The ID of the event.
+ * @param evt A pointer to the structure holding the event data.
+ *
+ * @return void
+ */
+void moistcfg_handle_events(uint32_t evt_id, struct gecko_cmd_packet *evt) {
+	switch(evt_id) {
+		case gecko_evt_system_external_signal_id:
+			if(evt->data.evt_system_external_signal.extsignals & CORE_EVT_NETWORK_READY) {
+				_init_model();
+			}
+			break;
+
+		case gecko_evt_mesh_vendor_model_receive_id:
+			/* Make sure it's actually for us */
+			if (evt->data.evt_mesh_vendor_model_receive.vendor_id != MOISTCFG_VENDOR_ID
+					|| evt->data.evt_mesh_vendor_model_receive.model_id != MOISTCFG_MODEL_ID) {
+				break;
+			}
+			_handle_message(&evt->data.evt_mesh_vendor_model_receive);
+			break;
+
+		default:
+			break;
+	}
+}
+
+/* What moistcfg_handle_events handles, so the router only hands it those */
+static const uint32_t subscribed_events[] = {
+		gecko_evt_mesh_vendor_model_receive_id
+};
+
+const router_subscription moistcfg_subscription = {
+		moistcfg_handle_events,
+		subscribed_events, ROUTER_COUNT(subscribed_events),
+		NULL, 0,
+		CORE_EVT_NETWORK_READY
+};
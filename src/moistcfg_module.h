@@ -0,0 +1,51 @@
+/*
+ * @file moistcfg_module.h
+ * @brief Moisture Configuration Module. A vendor model that lets the gateway
+ *     configure the sensor remotely.
+ *
+ * @author agent
+ * @date Oct 15, 2026
+ */
+
+#ifndef SRC_MOISTCFG_MODULE_H_
+#define SRC_MOISTCFG_MODULE_H_
+
+#include "stdint.h"
+#include "native_gecko.h"
+
+#include "router_module.h"
+
+#define MOISTCFG_VENDOR_ID (0x02FF) /* Our company ID from the DCD */
+#define MOISTCFG_MODEL_ID (0x0001)
+#define MOISTCFG_ELEMENT_INDEX (0)
+
+/*
+ * Opcodes. Payloads are little endian.
+ *   CALIB_GET    probe
+ *   CALIB_SET    probe, counts (2), vwc (2)    Adds or moves a point on the probe's curve
+ *   CALIB_RESET  probe                         Back to the default curve
+ *   CALIB_STATUS probe, status, count, then count pairs of counts (2), vwc (2)
+ *   PARAM_GET    param
+ *   PARAM_SET    param, value (4)               Changes a tunable; see moist_params for IDs and units
+ *   PARAM_STATUS param, status, value (4)       The value is what's in use after the get/set
+ * Every get/set/reset is answered with a status to whoever sent it. Parameter changes are saved
+ * through the settings store, so a burst of them costs one flash write for each record it touched
+ * (the valve dead time is in the valve's record, everything else in the moisture server's).
+ */
+#define MOISTCFG_OP_CALIB_GET (0x01)
+#define MOISTCFG_OP_CALIB_SET (0x02)
+#define MOISTCFG_OP_CALIB_RESET (0x03)
+#define MOISTCFG_OP_CALIB_STATUS (0x04)
+#define MOISTCFG_OP_PARAM_GET (0x05)
+#define MOISTCFG_OP_PARAM_SET (0x06)
+#define MOISTCFG_OP_PARAM_STATUS (0x07)
+
+#define MOISTCFG_STATUS_OK (0x00)
+#define MOISTCFG_STATUS_REJECTED (0x01)
+#define MOISTCFG_STATUS_UNKNOWN (0x02) /* No such parameter */
+
+void moistcfg_handle_events(uint32_t evt_id, struct gecko_cmd_packet *evt);
+
+extern const router_subscription moistcfg_subscription;
+
+#endif /* SRC_MOISTCFG_MODULE_H_ */
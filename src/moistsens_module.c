@@ -0,0 +1,493 @@
+/*
+ * @file moistsens_module.c
+ * @brief Moisture Sensor Module. A vendor model laid out like the mesh Sensor Server and
+ *     Sensor Setup Server that carries the calibrated readings and their publish cadence.
+ *
+ * @author agent
+ * @date Oct 15, 2026
+ */
+
+/* Standard Libraries */
+#include "stdint.h"
+#include "stdbool.h"
+
+/* Bluetooth stack headers */
+#include "bg_types.h"
+#include "native_gecko.h"
+
+#include "moistsens_module.h"
+#include "moistsrv_module.h"
+
+#include "debug.h"
+#include "user_signals_bt.h"
+
+/* Each probe's marshalled data: a 2 byte format A header and its 2 byte value */
+#define MOISTSENS_DATA_SIZE (4)
+/* property (2), divisor and trigger type, deltas (4), min interval, fast range (4), period (2) */
+#define MOISTSENS_CADENCE_SIZE (14)
+
+/* property (2), interval (2) and count ahead of the readings */
+#define MOISTSENS_BATCH_HEADER_SIZE (5)
+#define MOISTSENS_BATCH_PAYLOAD (MOISTSENS_BATCH_HEADER_SIZE + (PUBLISH_BATCH_SIZE * 2))
+
+#if defined(BATCH_PUBLISHING) && (MOISTSENS_BATCH_PAYLOAD > MOISTSENS_MAX_ACCESS_PAYLOAD)
+#error "PUBLISH_BATCH_SIZE won't fit in MESH_CFG_MAX_SEND_SEGS segments."
+#endif
+
+#if SOIL_PROBE_COUNT * MOISTSENS_DATA_SIZE > MOISTSENS_CADENCE_SIZE
+#define MOISTSENS_MAX_PAYLOAD (SOIL_PROBE_COUNT * MOISTSENS_DATA_SIZE)
+#else
+#define MOISTSENS_MAX_PAYLOAD (MOISTSENS_CADENCE_SIZE)
+#endif
+
+static const uint8_t opcodes[] = {
+		MOISTSENS_OP_GET,
+		MOISTSENS_OP_STATUS,
+		MOISTSENS_OP_CADENCE_GET,
+		MOISTSENS_OP_CADENCE_SET,
+		MOISTSENS_OP_CADENCE_SET_UNACK,
+		MOISTSENS_OP_CADENCE_STATUS,
+		MOISTSENS_OP_BATCH_STATUS,
+		MOISTSENS_OP_HISTORY_STATUS
+};
+
+/* The latest reading from each probe, and whether there's been one yet */
+static uint16_t values[SOIL_PROBE_COUNT];
+static bool have_value[SOIL_PROBE_COUNT];
+static bool model_ready = false;
+
+/* Readings saved up for the next batch, as a ring so the newest survive a publish that doesn't go out */
+static uint16_t batch[SOIL_PROBE_COUNT][PUBLISH_BATCH_SIZE];
+static uint8_t batch_head[SOIL_PROBE_COUNT];
+static uint8_t batch_count[SOIL_PROBE_COUNT];
+
+static void _init_model();
+static void _handle_message(const struct gecko_msg_mesh_vendor_model_receive_evt_t *msg);
+static bool _get_probe(uint16_t property, uint8_t *probe);
+static uint8_t _put_data(uint8_t *data, uint8_t probe);
+static uint8_t _put_empty(uint8_t *data, uint16_t property);
+static void _get_cadence(const uint8_t *data, moist_cadence *cadence);
+static uint8_t _put_cadence(uint8_t *data, uint16_t property);
+static bool _publish(uint8_t opcode, uint8_t len, const uint8_t *payload);
+static void _reply(const struct gecko_msg_mesh_vendor_model_receive_evt_t *msg, uint8_t opcode, uint8_t len, const uint8_t *payload);
+static uint16_t _get_uint16(const uint8_t *data);
+static void _put_uint16(uint8_t *data, uint16_t value);
+
+/*
+ * @brief Brings the vendor model online. Should be done once the node is provisioned.
+ *
+ * @return void
+ */
+static void _init_model() {
+	DEBUG_ASSERT_BGAPI_SUCCESS(
+			gecko_cmd_mesh_vendor_model_init(MOISTSENS_ELEMENT_INDEX, MOISTSENS_VENDOR_ID, MOISTSENS_MODEL_ID,
+					true, sizeof(opcodes), opcodes)
+			->result, "Failed to init sensor model.");
+	model_ready = true;
+	debug_log("Sensor model ready.");
+}
+
+/*
+ * @brief Acts on a message sent to our vendor model.
+ *
+ * @param msg The message as the BGAPI gave it to us.
+ *
+ * @return void
+ */
+static void _handle_message(const struct gecko_msg_mesh_vendor_model_receive_evt_t *msg) {
+	const uint8_t *data = msg->payload.data;
+	uint8_t len = msg->payload.len;
+	uint8_t payload[MOISTSENS_MAX_PAYLOAD];
+	uint8_t size = 0;
+	uint8_t probe;
+	moist_cadence cadence;
+
+	switch (msg->opcode) {
+		case MOISTSENS_OP_GET:
+			if (len < 2) {
+				/* Everything we've got */
+				for (probe = 0; probe < SOIL_PROBE_COUNT; ++probe) {
+					size += _put_data(&payload[size], probe);
+				}
+			} else if (_get_probe(_get_uint16(data), &probe)) {
+				size = _put_data(payload, probe);
+			} else {
+				/* Not ours; the Sensor Server answers with just the property ID */
+				size = _put_empty(payload, _get_uint16(data));
+			}
+			_reply(msg, MOISTSENS_OP_STATUS, size, payload);
+			break;
+
+		case MOISTSENS_OP_CADENCE_SET:
+		case MOISTSENS_OP_CADENCE_SET_UNACK:
+			if (len < MOISTSENS_CADENCE_SIZE || !_get_probe(_get_uint16(data), &probe)) {
+				return;
+			}
+			/* A cadence we can't honor is ignored, same as the Sensor Setup Server */
+			_get_cadence(data, &cadence);
+			if (!moistsrv_set_cadence(&cadence)) {
+				debug_log("Rejected sensor cadence.");
+				return;
+			}
+			debug_log("Sensor cadence set.");
+			if (msg->opcode == MOISTSENS_OP_CADENCE_SET_UNACK) {
+				return;
+			}
+			/* Fall through and answer with what we have now */
+		case MOISTSENS_OP_CADENCE_GET:
+			if (len < 2) {
+				return;
+			}
+			if (_get_probe(_get_uint16(data), &probe)) {
+				size = _put_cadence(payload, _get_uint16(data));
+			} else {
+				/* Unknown property; just echo it back */
+				_put_uint16(payload, _get_uint16(data));
+				size = 2;
+			}
+			_reply(msg, MOISTSENS_OP_CADENCE_STATUS, size, payload);
+			break;
+
+		default:
+			/* Statuses (and anything else) aren't for us */
+			break;
+	}
+}
+
+/*
+ * @brief Works out which probe a property ID refers to.
+ *
+ * @param property The property ID.
+ * @param probe Where to put the probe.
+ *
+ * @return True if the property is one of ours.
+ */
+static bool _get_probe(uint16_t property, uint8_t *probe) {
+	if (property < MOISTSENS_PROPERTY_ID || property >= MOISTSENS_PROPERTY_ID + SOIL_PROBE_COUNT) {
+		return false;
+	}
+
+	*probe = property - MOISTSENS_PROPERTY_ID;
+	return true;
+}
+
+/*
+ * @brief Writes a probe's reading as marshalled sensor data.
+ *
+ * Format A packs the format bit (0), the value length less one, and an 11 bit property ID into two bytes.
+ * A probe that hasn't been read yet is sent with no value.
+ *
+ * @param data Where to write. Needs MOISTSENS_DATA_SIZE bytes.
+ * @param probe Which probe to write.
+ *
+ * @return How many bytes were written.
+ */
+static uint8_t _put_data(uint8_t *data, uint8_t probe) {
+	uint16_t property = MOISTSENS_PROPERTY_ID + probe;
+
+	if (!have_value[probe]) {
+		return _put_empty(data, property);
+	}
+
+	_put_uint16(data, (property << 5) | ((sizeof(uint16_t) - 1) << 1));
+	_put_uint16(&data[2], values[probe]);
+	return MOISTSENS_DATA_SIZE;
+}
+
+/*
+ * @brief Writes marshalled sensor data with no value, which is how a Sensor Server says it doesn't know.
+ *
+ * That takes format B: the format bit (1) and a length of 0x7F in the first byte, then the whole property ID.
+ *
+ * @param data Where to write. Needs 3 bytes.
+ * @param property The property ID with no value.
+ *
+ * @return How many bytes were written.
+ */
+static uint8_t _put_empty(uint8_t *data, uint16_t property) {
+	data[0] = 0x01 | (0x7F << 1);
+	_put_uint16(&data[1], property);
+	return 3;
+}
+
+/*
+ * @brief Reads a cadence out of a set message.
+ *
+ * @param data The message payload, starting with the property ID.
+ * @param cadence Where to put the cadence.
+ *
+ * @return void
+ */
+static void _get_cadence(const uint8_t *data, moist_cadence *cadence) {
+	cadence->fast_divisor = data[2] & 0x7F;
+	cadence->trigger_percent = (data[2] & 0x80) != 0;
+	cadence->delta_down = _get_uint16(&data[3]);
+	cadence->delta_up = _get_uint16(&data[5]);
+	cadence->min_interval = data[7];
+	cadence->fast_low = _get_uint16(&data[8]);
+	cadence->fast_high = _get_uint16(&data[10]);
+	cadence->period = _get_uint16(&data[12]);
+}
+
+/*
+ * @brief Writes the current cadence for a cadence status.
+ *
+ * @param data Where to write. Needs MOISTSENS_CADENCE_SIZE bytes.
+ * @param property The property ID to report it for.
+ *
+ * @return How many bytes were written.
+ */
+static uint8_t _put_cadence(uint8_t *data, uint16_t property) {
+	moist_cadence cadence;
+
+	moistsrv_get_cadence(&cadence);
+
+	_put_uint16(data, property);
+	data[2] = cadence.fast_divisor | (cadence.trigger_percent ? 0x80 : 0x00);
+	_put_uint16(&data[3], cadence.delta_down);
+	_put_uint16(&data[5], cadence.delta_up);
+	data[7] = cadence.min_interval;
+	_put_uint16(&data[8], cadence.fast_low);
+	_put_uint16(&data[10], cadence.fast_high);
+	_put_uint16(&data[12], cadence.period);
+	return MOISTSENS_CADENCE_SIZE;
+}
+
+/*
+ * @brief Publishes readings that didn't go out when they were taken.
+ *
+ * @param entries The readings, oldest first.
+ * @param count How many there are. No more than MOISTSENS_MAX_HISTORY.
+ *
+ * @return True if they went out.
+ */
+bool moistsens_publish_history(const history_entry *entries, uint8_t count) {
+	uint8_t payload[1 + (MOISTSENS_MAX_HISTORY * 8)];
+	uint32_t now = gecko_cmd_hardware_get_time()->seconds;
+	uint32_t age;
+	uint8_t i;
+
+	if (!model_ready || count == 0 || count > MOISTSENS_MAX_HISTORY) {
+		return false;
+	}
+
+	payload[0] = count;
+	for (i = 0; i < count; ++i) {
+		age = now - entries[i].time;
+		_put_uint16(&payload[1 + (i * 8)], MOISTSENS_PROPERTY_ID + entries[i].probe);
+		_put_uint16(&payload[3 + (i * 8)], age & 0xFFFF);
+		_put_uint16(&payload[5 + (i * 8)], age >> 16);
+		_put_uint16(&payload[7 + (i * 8)], entries[i].vwc);
+	}
+
+	return _publish(MOISTSENS_OP_HISTORY_STATUS, 1 + (count * 8), payload);
+}
+
+/*
+ * @brief Publishes a message to wherever our model publishes.
+ *
+ * @param opcode The opcode of the message.
+ * @param len How long the message is.
+ * @param payload The message.
+ *
+ * @return True if it went out.
+ */
+static bool _publish(uint8_t opcode, uint8_t len, const uint8_t *payload) {
+	errorcode_t result;
+
+	result = gecko_cmd_mesh_vendor_model_set_publication(MOISTSENS_ELEMENT_INDEX, MOISTSENS_VENDOR_ID, MOISTSENS_MODEL_ID,
+			opcode, true, len, payload)->result;
+	if (result == bg_err_success) {
+		result = gecko_cmd_mesh_vendor_model_publish(MOISTSENS_ELEMENT_INDEX, MOISTSENS_VENDOR_ID, MOISTSENS_MODEL_ID)->result;
+	}
+
+	debug_log("Sensor message 0x%02X published. Result: 0x%04X", opcode, result);
+	return (result == bg_err_success);
+}
+
+/*
+ * @brief Answers whoever sent a message.
+ *
+ * @param msg The message we're answering.
+ * @param opcode The opcode of the answer.
+ * @param len How long the answer is.
+ * @param payload The answer.
+ *
+ * @return void
+ */
+static void _reply(const struct gecko_msg_mesh_vendor_model_receive_evt_t *msg, uint8_t opcode, uint8_t len, const uint8_t *payload) {
+	errorcode_t result;
+
+	result = gecko_cmd_mesh_vendor_model_send(
+			msg->elem_index,
+			MOISTSENS_VENDOR_ID,
+			MOISTSENS_MODEL_ID,
+			msg->source_address,
+			msg->va_index,
+			msg->appkey_index,
+			msg->nonrelayed,
+			opcode,
+			true,
+			len,
+			payload)->result;
+
+	debug_log("Sensor reply 0x%02X sent. Result: 0x%04X", opcode, result);
+}
+
+/*
+ * @brief Reads a little endian 16 bit value out of a message.
+ *
+ * @param data Where the value starts.
+ *
+ * @return The value.
+ */
+static uint16_t _get_uint16(const uint8_t *data) {
+	return (uint16_t) (data[0] | (data[1] << 8));
+}
+
+/*
+ * @brief Writes a little endian 16 bit value into a message.
+ *
+ * @param data Where the value should go.
+ * @param value The value.
+ *
+ * @return void
+ */
+static void _put_uint16(uint8_t *data, uint16_t value) {
+	data[0] = value & 0xFF;
+	data[1] = value >> 8;
+}
+
+/*
+ * @brief Records a probe's latest reading so it can be read back or published.
+ *
+ * @param probe Which probe the reading came from.
+ * @param vwc The reading, in 0.01 % VWC.
+ *
+ * @return void
+ */
+void moistsens_update(uint8_t probe, uint16_t vwc) {
+	if (probe >= SOIL_PROBE_COUNT) {
+		return;
+	}
+
+	values[probe] = vwc;
+	have_value[probe] = true;
+}
+
+/*
+ * @brief Publishes a probe's latest reading as a sensor status.
+ *
+ * @param probe Which probe to publish.
+ *
+ * @return True if it went out.
+ */
+bool moistsens_publish(uint8_t probe) {
+	uint8_t payload[MOISTSENS_DATA_SIZE];
+	uint8_t size;
+
+	if (!model_ready || probe >= SOIL_PROBE_COUNT) {
+		return false;
+	}
+
+	size = _put_data(payload, probe);
+	return _publish(MOISTSENS_OP_STATUS, size, payload);
+}
+
+/*
+ * @brief Saves a probe's latest reading (see moistsens_update) for its next batch.
+ *
+ * Once the batch is full, the oldest reading is dropped to make room.
+ *
+ * @param probe Which probe to save the reading of.
+ *
+ * @return True if the batch is full and should be published.
+ */
+bool moistsens_batch_add(uint8_t probe) {
+	if (probe >= SOIL_PROBE_COUNT || !have_value[probe]) {
+		return false;
+	}
+
+	batch[probe][(batch_head[probe] + batch_count[probe]) % PUBLISH_BATCH_SIZE] = values[probe];
+	if (batch_count[probe] < PUBLISH_BATCH_SIZE) {
+		++batch_count[probe];
+	} else {
+		batch_head[probe] = (batch_head[probe] + 1) % PUBLISH_BATCH_SIZE;
+	}
+
+	return (batch_count[probe] == PUBLISH_BATCH_SIZE);
+}
+
+/*
+ * @brief Publishes the readings a probe has saved up as one batch status, and starts a new batch if it went out.
+ *
+ * @param probe Which probe's batch to publish.
+ *
+ * @return True if it went out.
+ */
+bool moistsens_batch_publish(uint8_t probe) {
+	uint8_t payload[MOISTSENS_BATCH_PAYLOAD];
+	uint8_t i;
+
+	if (!model_ready || probe >= SOIL_PROBE_COUNT || batch_count[probe] == 0) {
+		return false;
+	}
+
+	_put_uint16(payload, MOISTSENS_PROPERTY_ID + probe);
+	_put_uint16(&payload[2], moistsrv_get_measurement_interval());
+	payload[4] = batch_count[probe];
+	for (i = 0; i < batch_count[probe]; ++i) {
+		_put_uint16(&payload[MOISTSENS_BATCH_HEADER_SIZE + (i * 2)], batch[probe][(batch_head[probe] + i) % PUBLISH_BATCH_SIZE]);
+	}
+
+	if (!_publish(MOISTSENS_OP_BATCH_STATUS, MOISTSENS_BATCH_HEADER_SIZE + (batch_count[probe] * 2), payload)) {
+		return false;
+	}
+
+	batch_head[probe] = 0;
+	batch_count[probe] = 0;
+	return true;
+}
+
+/*
+ * @brief Responds to events generated by the BGAPI message queue
+ * that are related to the sensor module.
+ *
+ * @param evt_id The ID of the event.
+ * @param evt A pointer to the structure holding the event data.
+ *
+ * @return void
+ */
+void moistsens_handle_events(uint32_t evt_id, struct gecko_cmd_packet *evt) {
+	switch(evt_id) {
+		case gecko_evt_system_external_signal_id:
+			if(evt->data.evt_system_external_signal.extsignals & CORE_EVT_NETWORK_READY) {
+				_init_model();
+			}
+			break;
+
+		case gecko_evt_mesh_vendor_model_receive_id:
+			/* Make sure it's actually for us */
+			if (evt->data.evt_mesh_vendor_model_receive.vendor_id != MOISTSENS_VENDOR_ID
+					|| evt->data.evt_mesh_vendor_model_receive.model_id != MOISTSENS_MODEL_ID) {
+				break;
+			}
+			_handle_message(&evt->data.evt_mesh_vendor_model_receive);
+			break;
+
+		default:
+			break;
+	}
+}
+
+/* What moistsens_handle_events handles, so the router only hands it those */
+static const uint32_t subscribed_events[] = {
+		gecko_evt_mesh_vendor_model_receive_id
+};
+
+const router_subscription moistsens_subscription = {
+		moistsens_handle_events,
+		subscribed_events, ROUTER_COUNT(subscribed_events),
+		NULL, 0,
+		CORE_EVT_NETWORK_READY
+};
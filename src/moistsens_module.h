@@ -0,0 +1,88 @@
+/*
+ * @file moistsens_module.h
+ * @brief Moisture Sensor Module. A vendor model laid out like the mesh Sensor Server and
+ *     Sensor Setup Server that carries the calibrated readings and their publish cadence.
+ *
+ * @author agent
+ * @date Oct 15, 2026
+ */
+
+#ifndef SRC_MOISTSENS_MODULE_H_
+#define SRC_MOISTSENS_MODULE_H_
+
+#include "stdint.h"
+#include "stdbool.h"
+#include "native_gecko.h"
+
+#include "router_module.h"
+
+#include "mesh_app_memory_config.h"
+
+#include "soil_driver_bt.h"
+#include "history_module.h"
+
+#define MOISTSENS_VENDOR_ID (0x02FF) /* Our company ID from the DCD */
+#define MOISTSENS_MODEL_ID (0x0002)
+#define MOISTSENS_ELEMENT_INDEX (0)
+
+/*
+ * There's no SIG property for soil moisture, so we use one out of the unassigned space. Each probe
+ * gets its own, starting here. Values are volumetric water content in 0.01 % units (uint16).
+ */
+#define MOISTSENS_PROPERTY_ID (0x0700)
+
+/*
+ * Opcodes. Payloads are little endian and follow the Sensor model messages of the same name.
+ *   GET                 [property (2)]              No property means every probe
+ *   STATUS              Marshalled sensor data (format A) for each probe asked about
+ *   CADENCE_GET         property (2)
+ *   CADENCE_SET         property (2), cadence       Answered with a CADENCE_STATUS
+ *   CADENCE_SET_UNACK   property (2), cadence
+ *   CADENCE_STATUS      property (2), cadence
+ * where cadence is:
+ *   divisor | (trigger type << 7), delta down (2), delta up (2), min interval, fast low (2),
+ *   fast high (2), period (2)
+ * The trailing period (seconds) isn't in the SIG message; our vendor publications aren't periodic
+ * on their own, so it stands in for the model publication period. All probes share one cadence.
+ */
+#define MOISTSENS_OP_GET (0x10)
+#define MOISTSENS_OP_STATUS (0x11)
+#define MOISTSENS_OP_CADENCE_GET (0x12)
+#define MOISTSENS_OP_CADENCE_SET (0x13)
+#define MOISTSENS_OP_CADENCE_SET_UNACK (0x14)
+#define MOISTSENS_OP_CADENCE_STATUS (0x15)
+
+/*
+ * Batched readings, when BATCH_PUBLISHING is on. Published only; laid out like a Sensor Series
+ * Status cut down to one column per reading:
+ *   BATCH_STATUS        property (2), interval (2), count, then count readings (2), oldest first
+ * The interval is the time between readings in seconds, and the newest reading is the one just taken.
+ */
+#define MOISTSENS_OP_BATCH_STATUS (0x16)
+
+/*
+ * Readings held back while we had nowhere to send them. Published only, and only ever the ones
+ * that didn't make it out the first time:
+ *   HISTORY_STATUS      count, then count of property (2), age (4), reading (2)
+ * The age is how many seconds ago the reading was taken, so it doesn't matter that our clock
+ * started at boot.
+ */
+#define MOISTSENS_OP_HISTORY_STATUS (0x17)
+
+/*
+ * A segmented message carries 12 bytes a segment, less the 4 byte TransMIC, and our vendor opcode
+ * takes 3 of those. Anything bigger than that can't be sent at all.
+ */
+#define MOISTSENS_MAX_ACCESS_PAYLOAD ((MESH_CFG_MAX_SEND_SEGS * 12) - 4 - 3)
+#define MOISTSENS_MAX_HISTORY ((MOISTSENS_MAX_ACCESS_PAYLOAD - 1) / 8)
+
+void moistsens_update(uint8_t probe, uint16_t vwc);
+bool moistsens_publish(uint8_t probe);
+bool moistsens_batch_add(uint8_t probe);
+bool moistsens_batch_publish(uint8_t probe);
+bool moistsens_publish_history(const history_entry *entries, uint8_t count);
+void moistsens_handle_events(uint32_t evt_id, struct gecko_cmd_packet *evt);
+
+extern const router_subscription moistsens_subscription;
+
+#endif /* SRC_MOISTSENS_MODULE_H_ */
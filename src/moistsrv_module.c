@@ -9,9 +9,11 @@
 
 /* Standard Libraries */
 #include "stdio.h"
-#include "stdlib.h" /* pulls in malloc and free for us. */
+#include "stdlib.h"
 #include "stdint.h"
 #include "stdbool.h"
+#include "string.h"
+#include "stddef.h"
 
 /* Bluetooth stack headers */
 #include "bg_types.h"
@@ -21,12 +23,19 @@
 #include <mesh_sizes.h>
 #include <mesh_generic_model_capi_types.h>
 #include <mesh_lib.h>
+#include "mesh_app_memory_config.h"
 
 #include <sleep.h>
 #include <src/soil_driver_bt.h>
 
 #include "meshconn_module.h"
 #include "moistsrv_module.h"
+#include "moistsrv_settings.h"
+#include "calib_module.h"
+#include "moistsens_module.h"
+#include "history_module.h"
+#include "settings_module.h"
+#include "valve_module.h"
 
 #include "lcd_driver.h"
 #include "pb_driver_bt.h"
@@ -35,31 +44,64 @@
 #include "debug.h"
 #include "user_signals_bt.h"
 
-/*
- * Using PACKSTRCT so we don't end up with a bunch of wasted memory.
- * The price we pay is access delays since the struct's members aren't
- * going to be aligned, but we're not doing a lot with this struct, so
- * longer access times are okay.
- */
-typedef PACKSTRUCT(struct {
-	uint16_t alarm_level;
-}) persistent_data;
+/* Every probe is published on its own element, starting at MOISTURE_ELEMENT_INDEX */
+#if (MOISTURE_ELEMENT_INDEX + SOIL_PROBE_COUNT) > MESH_CFG_MAX_ELEMENTS
+#error "Each soil probe needs its own element with a Generic Level Server in btMesh_configuration.json."
+#endif
+
+#if defined(AUTONOMOUS_SAMPLING) && (SOIL_PROBE_COUNT > 1)
+#error "Autonomous sampling only covers the first probe."
+#endif
+
+/* Autonomous readings come at no fixed interval, so a batch couldn't say when they were taken */
+#if defined(AUTONOMOUS_SAMPLING) && defined(BATCH_PUBLISHING)
+#error "Batch publishing needs readings at a fixed interval, which autonomous sampling doesn't give."
+#endif
+
+typedef enum { alarm_clear, alarm_set } alarm_states;
 
-static persistent_data settings;
+static moistsrv_settings settings;
+static uint32_t settle_ticks;
 static bool disable_deep_sleep = false;
 static bool ready = false;
+/* Set while we're a low power node without a friend, when there's nobody to pass our publishes on */
+static bool friendless = false;
 static uint8_t conn_count = 0;
+static uint16_t last_measurement = 0;
+
+/* How often we're measuring right now, and the last few readings from each probe that decided it */
+static uint16_t measurement_interval = MEASUREMENT_MIN_TIME;
+static uint16_t recent[SOIL_PROBE_COUNT][ADAPT_WINDOW];
+static uint8_t recent_count = 0;
+
+/* What each probe last told the network, and when, so we only speak up when it's worth it */
+static bool published[SOIL_PROBE_COUNT];
+static uint16_t last_published[SOIL_PROBE_COUNT];
+static uint32_t last_publish_time[SOIL_PROBE_COUNT];
+
+/* Where each probe's alarm is, how many readings in a row have disagreed with that, and when it was last sent */
+static alarm_states alarm_state[SOIL_PROBE_COUNT];
+static uint8_t alarm_pending[SOIL_PROBE_COUNT];
+static uint32_t last_alarm_time[SOIL_PROBE_COUNT];
+static uint32_t publishes_sent = 0;
+static uint32_t publishes_suppressed = 0;
 
 
 #define ALARM_FLASH_KEY (0x4001)
-#define DEFAULT_ALARM_LEVEL (0x7FFF)
+/* The probe settle time lives on its own key so it can be learned without touching the user's settings. */
+#define SETTLE_FLASH_KEY (0x4002)
+/* Bump this whenever the settle time changes shape, and teach the migration about the old one */
+#define SETTLE_VERSION (1)
 
 static void _toast(char *message);
-static void _save_settings();
+static void _log_stats();
 static void _load_settings();
+static bool _migrate_settle_time(uint8_t version, const uint8_t *old, uint8_t len, void *data);
+static void _load_settle_time();
 static void _set_alarm_level(uint16_t new_level);
-static void _publish_moisture(uint16_t level);
-static void _update_level(uint16_t level);
+static bool _set_cadence(const moist_cadence *cadence);
+static void _publish_moisture(uint16_t element_index, uint16_t level);
+static void _update_level(uint16_t element_index, uint16_t level);
 static void _handle_client_request(uint16_t model_id,
         uint16_t element_index,
         uint16_t client_addr,
@@ -78,17 +120,26 @@ static void _init_and_register_models();
 static void _become_lpn();
 static void _get_friend();
 static void _delay_befriending();
+static void _start_drain();
+static void _stop_drain();
+static void _drain_history();
 static void _do_measurement();
 static void _finish_measurement();
+static uint16_t _report_reading(uint8_t probe, const soil_reading *reading);
+static void _adapt_interval(const uint16_t *levels, uint16_t supply_mv);
+static void _start_measurement_timer();
+static bool _should_publish(uint8_t probe, uint16_t level, bool crossed);
+static bool _step_alarm(uint8_t probe, uint16_t level);
+static uint16_t _get_clear_level();
+static void _update_autonomous_window();
+static uint32_t _get_seconds();
 
 /*
- * Why these values? Well, to be honest, the sweet spot for our project will be bewteen lux level 2 and 3.
- * Similarly, the gap between damp and wet sand for this sensor setup seems to land at 0x0D00, with soaked sand
- * being at 0x0D14-ish and damp being at 0x0C50. This will let us demonstrate the alarm thresholds fairly easily.
- * The rest of the numbers are pretty much arbitrary. More engineering would be possible, but realistically this
- * table should be set using a user settings model and a direct measurement mode.
+ * Alarm levels are volumetric water content in 0.01 % units (see calib_module), so a level means the
+ * same thing on every node once its probes are calibrated. The table runs from saturated (40 %) down to
+ * quite dry (5 %); the sweet spot for most beds is between levels 2 and 3.
  */
-static const uint16_t lux_to_alarm_table[] = {0x0F00,0x0E00,0x0D00,0xC00,0xB00,0xA00,0x900,0x800,0x400,0x300,0x200};
+static const uint16_t lux_to_alarm_table[] = {4000,3500,3000,2500,2000,1750,1500,1250,1000,750,500};
 static const uint8_t max_lux = sizeof(lux_to_alarm_table)-1;
 
 /*
@@ -110,15 +161,22 @@ static void _toast(char *message) {
 }
 
 /*
- * @brief Commits the settings to flash.
+ * @brief Logs what saving settings and dispatching events have cost so far.
  *
  * @return void
  */
-static void _save_settings() {
-	DEBUG_ASSERT_BGAPI_SUCCESS(
-			gecko_cmd_flash_ps_save(ALARM_FLASH_KEY,2,(uint8_t*) &settings)
-			->result, "Failed to save new alarm setting.");
-	debug_log("Settings saved.");
+static void _log_stats() {
+	settings_stats flash;
+	router_stats dispatch;
+
+	settings_get_stats(&flash);
+	router_get_stats(&dispatch);
+	debug_log("Settings: %lu changes, %lu writes, %lu unchanged.",
+			(unsigned long) flash.requests, (unsigned long) flash.writes, (unsigned long) flash.unchanged);
+	debug_log("Router: %lu events, %lu unrouted, %lu cycles each on average, %lu at most.",
+			(unsigned long) dispatch.events, (unsigned long) dispatch.unrouted,
+			(unsigned long) (dispatch.events ? (dispatch.cycles / dispatch.events) : 0),
+			(unsigned long) dispatch.max_cycles);
 }
 
 /*
@@ -137,14 +195,15 @@ static void _set_alarm_level(uint16_t new_level) {
 	/* Record the new setting */
 	settings.alarm_level = new_level;
 
+	/* Make sure the hardware wakes us for the new threshold */
+	_update_autonomous_window();
+
 	/* Show it to the user */
-	sprintf(prompt_buffer, "ALM LVL: 0x%04X", settings.alarm_level);
+	sprintf(prompt_buffer, "ALM LVL: %d.%02d%%", settings.alarm_level / 100, settings.alarm_level % 100);
 	_toast(prompt_buffer);
 
-	/* Start the timer to save the settings eventually */
-	DEBUG_ASSERT_BGAPI_SUCCESS(
-			gecko_cmd_hardware_set_soft_timer(GET_SOFT_TIMER_COUNTS(SAVE_DELAY), SAVE_TIMER_HANDLE, SOFT_TIMER_ONE_SHOT)
-			->result, "Failed to save new alarm setting.");
+	/* Save the settings once the changes stop coming */
+	settings_mark_dirty(ALARM_FLASH_KEY);
 }
 
 /*
@@ -153,59 +212,109 @@ static void _set_alarm_level(uint16_t new_level) {
  * @return void
  */
 static void _load_settings() {
-	struct gecko_msg_flash_ps_load_rsp_t *result;
-	bool loaded = false;
-
 	debug_log("Loading settings starting with defaults...");
-	result = gecko_cmd_flash_ps_load(ALARM_FLASH_KEY);
 
 	/* Start with the default */
 	settings.alarm_level = DEFAULT_ALARM_LEVEL;
-
-	/* And if we actually got a good result */
-	if (result->result == bg_err_success) {
-		/* And it looks like the kind of data it's supposed to be */
-		if(result->value.len == sizeof(settings)) {
-			/* Set our settings */
-			settings = *((persistent_data*) result->value.data);
-			debug_log("Successfully loaded non-default values");
-			loaded = true;
-		}
-	}
-
-	/* If we weren't able to load the settings */
-	if (!loaded) {
+	settings.cadence.period = PUBLISH_PERIOD;
+	settings.cadence.fast_divisor = PUBLISH_FAST_DIVISOR;
+	settings.cadence.trigger_percent = PUBLISH_TRIGGER_PERCENT;
+	settings.cadence.delta_down = PUBLISH_DELTA_DOWN;
+	settings.cadence.delta_up = PUBLISH_DELTA_UP;
+	settings.cadence.min_interval = PUBLISH_MIN_INTERVAL;
+	settings.cadence.fast_low = PUBLISH_FAST_LOW;
+	settings.cadence.fast_high = PUBLISH_FAST_HIGH;
+	settings.alarm_hysteresis = ALARM_HYSTERESIS;
+	settings.alarm_debounce = ALARM_DEBOUNCE;
+	settings.alarm_reminder = ALARM_REMINDER;
+	settings.measure_min = MEASUREMENT_MIN_TIME;
+	settings.measure_max = MEASUREMENT_MAX_TIME;
+	settings.autonomous_deadband = AUTONOMOUS_DEADBAND;
+	settings.sample_count = SOIL_DEFAULT_SAMPLE_COUNT;
+	settings.lpn_poll_timeout = LPN_POLL_TIMEOUT;
+	settings.rel_delta_down = PUBLISH_REL_DELTA_DOWN;
+	settings.rel_delta_up = PUBLISH_REL_DELTA_UP;
+
+	/* Then whatever's in flash over the top */
+	settings_register(ALARM_FLASH_KEY, MOISTSRV_SETTINGS_VERSION, &settings, sizeof(settings), moistsrv_migrate_settings);
+	if (settings_load(ALARM_FLASH_KEY)) {
+		debug_log("Successfully loaded non-default values");
+	} else {
 		debug_log("Using defaults and initializing flash...");
 		/* Push the defaults back to the flash */
-		_save_settings();
+		settings_mark_dirty(ALARM_FLASH_KEY);
 	}
 
-	debug_log("Finished loading settings. Alarm level loaded is %d.", settings.alarm_level);
+	debug_log("Finished loading settings. Alarm level loaded is %d. Publishing on -%d/+%d or -%d/+%d relative, every %ds at least.",
+			settings.alarm_level, settings.cadence.delta_down, settings.cadence.delta_up,
+			settings.rel_delta_down, settings.rel_delta_up, settings.cadence.period);
+}
+
+/*
+ * @brief Brings a settle time saved by an older version forward.
+ *
+ * Before the settings store, it was saved as the raw tick count.
+ *
+ * @param version The version of the old settle time.
+ * @param old The old settle time.
+ * @param len How long the old settle time is.
+ * @param data Our settle time.
+ *
+ * @return True if it could be used.
+ */
+static bool _migrate_settle_time(uint8_t version, const uint8_t *old, uint8_t len, void *data) {
+	if (version == 0 && len == sizeof(uint32_t)) {
+		memcpy(data, old, sizeof(uint32_t));
+		return true;
+	}
+	return false;
+}
+
+/*
+ * @brief Restores the learned probe settle time from flash, and failing that, has the driver learn one.
+ *
+ * @return void
+ */
+static void _load_settle_time() {
+	settings_register(SETTLE_FLASH_KEY, SETTLE_VERSION, &settle_ticks, sizeof(settle_ticks), _migrate_settle_time);
+
+	/* If there's a sane looking value there, use it */
+	if (settings_load(SETTLE_FLASH_KEY)) {
+		soil_set_settle_time(settle_ticks);
+		debug_log("Loaded probe settle time of %lu ticks.", soil_get_settle_time());
+	} else {
+		/* Otherwise figure it out on the first reading. It'll be saved once we know. */
+		debug_log("No probe settle time saved. Learning one.");
+		soil_start_learning();
+	}
 }
 
 /*
  * @brief Publishes the moisture level or alarm to the network.
  *
+ * @param element_index The element of the probe the level belongs to.
  * @param level The moisture level to be published to the network.
  *
  * @return void
  */
-static void _publish_moisture(uint16_t level) {
+static void _publish_moisture(uint16_t element_index, uint16_t level) {
 	errorcode_t result;
 
 	/* Update the model */
-	_update_level(level);
+	_update_level(element_index, level);
 
 	/* And send the value to the mesh */
 	result=mesh_lib_generic_server_publish(
 				MESH_GENERIC_LEVEL_SERVER_MODEL_ID,
-				MOISTURE_ELEMENT_INDEX,
+				element_index,
 				mesh_generic_state_level);
 
 	/* If something goes wrong, say something. */
 	if (result != bg_err_success) {
 		sprintf(prompt_buffer,"P-ERR: 0x%04X", result);
 		_toast(prompt_buffer);
+	} else {
+		++publishes_sent;
 	}
 
 	debug_log("Published. Result: 0x%04X", result);
@@ -214,11 +323,12 @@ static void _publish_moisture(uint16_t level) {
 /*
  * @brief Updates the BGAPI copy of our data
  *
+ * @param element_index The element of the probe the level belongs to.
  * @param level The new moisture value our model should be updated to.
  *
  * @return void
  */
-static void _update_level(uint16_t level) {
+static void _update_level(uint16_t element_index, uint16_t level) {
 	struct mesh_generic_state outbound_state;
 	struct mesh_generic_state next_state;
 	errorcode_t result;
@@ -232,7 +342,7 @@ static void _update_level(uint16_t level) {
 	/* And hand it to mesh_lib so it can update the BGAPI */
 	result = mesh_lib_generic_server_update(
 			MESH_GENERIC_LEVEL_SERVER_MODEL_ID,
-			MOISTURE_ELEMENT_INDEX,
+			element_index,
 			&outbound_state,
 			&next_state,
 			0);
@@ -361,18 +471,22 @@ static void _handle_server_change(uint16_t model_id,
  * @return void
  */
 static void _init_and_register_models() {
+	uint8_t probe;
+
 	/* Init mesh_lib now that we're provisioned. */
 	debug_log("Starting up meshlib...");
-	DEBUG_ASSERT_BGAPI_SUCCESS(mesh_lib_init(malloc, free, 8),
+	DEBUG_ASSERT_BGAPI_SUCCESS(mesh_lib_init(NULL, NULL, MESH_CFG_MAX_MODELS),
 			"Failed to init mesh_lib");
 
-	/* Register our model handler. */
+	/* Register our model handler on each probe's element. */
 	debug_log("Registering models...");
-	DEBUG_ASSERT_BGAPI_SUCCESS(mesh_lib_generic_server_register_handler(
-		MESH_GENERIC_LEVEL_SERVER_MODEL_ID,
-		MOISTURE_ELEMENT_INDEX, // Why 0? Because their system doesn't currently make an element array constant. >.<
-		_handle_client_request,
-		_handle_server_change),"Error registering generic level model.");
+	for (probe = 0; probe < SOIL_PROBE_COUNT; ++probe) {
+		DEBUG_ASSERT_BGAPI_SUCCESS(mesh_lib_generic_server_register_handler(
+			MESH_GENERIC_LEVEL_SERVER_MODEL_ID,
+			MOISTURE_ELEMENT_INDEX + probe, // Why 0? Because their system doesn't currently make an element array constant. >.<
+			_handle_client_request,
+			_handle_server_change),"Error registering generic level model.");
+	}
 
 	/* Mark that we're fully configured and it's safe to make calls against mesh_lib */
 	ready = true;
@@ -385,6 +499,10 @@ static void _init_and_register_models() {
  * @return void
  */
 static void _become_full_power() {
+	/* The connection can carry our publishes, so anything held back can go now */
+	friendless = false;
+	_start_drain();
+
 	/* Stop the befriend retry timer. */
 	DEBUG_ASSERT_BGAPI_SUCCESS(
 			gecko_cmd_hardware_set_soft_timer(SOFT_TIMER_STOP, BEFRIEND_TIMER_HANDLE, SOFT_TIMER_ONE_SHOT)
@@ -406,6 +524,7 @@ static void _become_lpn() {
 		return;
 	}
 
+	friendless = true;
 	debug_log("Becoming friend...");
 	LCD_write("Not Friended", LCD_ROW_CONNECTION);
 	DEBUG_ASSERT_BGAPI_SUCCESS(
@@ -413,7 +532,7 @@ static void _become_lpn() {
 			->result, "Failed to initialize LPN functionality.");
 
 	DEBUG_ASSERT_BGAPI_SUCCESS(
-			gecko_cmd_mesh_lpn_configure(LPN_QUEUE_DEPTH, LPN_POLL_TIMEOUT)
+			gecko_cmd_mesh_lpn_configure(LPN_QUEUE_DEPTH, settings.lpn_poll_timeout)
 			->result, "Failed to set LPN requirements.");
 
 	_get_friend();
@@ -460,14 +579,69 @@ static void _delay_befriending() {
 			->result, "Failed to start friendship retry timer.");
 }
 
+/*
+ * @brief Starts sending the readings that were held back while we had no friend, if there are any.
+ *
+ * They go out a few at a time every DRAIN_TIME so the catch up doesn't swamp the friend's queue.
+ *
+ * @return void
+ */
+static void _start_drain() {
+	if (history_count_pending() == 0) {
+		return;
+	}
+
+	debug_log("Backfilling %d readings.", history_count_pending());
+	DEBUG_ASSERT_BGAPI_SUCCESS(
+			gecko_cmd_hardware_set_soft_timer(GET_SOFT_TIMER_COUNTS(DRAIN_TIME), DRAIN_TIMER_HANDLE, SOFT_TIMER_FREE_RUN)
+			->result, "Failed to start backfill timer.");
+}
+
+/*
+ * @brief Stops sending held back readings. Whatever's left stays queued.
+ *
+ * @return void
+ */
+static void _stop_drain() {
+	DEBUG_ASSERT_BGAPI_SUCCESS(
+			gecko_cmd_hardware_set_soft_timer(SOFT_TIMER_STOP, DRAIN_TIMER_HANDLE, SOFT_TIMER_ONE_SHOT)
+			->result, "Failed to stop backfill timer.");
+}
+
+/*
+ * @brief Sends the next message's worth of held back readings, and stops once they've all gone.
+ *
+ * @return void
+ */
+static void _drain_history() {
+	history_entry entries[MOISTSENS_MAX_HISTORY];
+	uint8_t count;
+
+	count = history_get_pending(entries, MOISTSENS_MAX_HISTORY);
+	if (count == 0) {
+		_stop_drain();
+		return;
+	}
+
+	/* If it doesn't go, they'll still be there next time */
+	if (moistsens_publish_history(entries, count)) {
+		history_mark_sent(count);
+		++publishes_sent;
+	}
+}
+
 /*
  * @brief Starts powering on the ADC. Will raise an event when the power on delays are finished.
  *
  * @return void
  */
 static void _do_measurement() {
-	/* Turn on the ADC and sensor */
+	/* Turn on the ADC and sensor(s) */
+#if SOIL_PROBE_COUNT > 1
+	soil_start_scan_async();
+#else
 	soil_start_reading_async();
+#endif
 }
 
 /*
@@ -478,31 +652,687 @@ static void _do_measurement() {
  * @return void
  */
 static void _finish_measurement() {
-	uint16_t measurement;
+	soil_reading readings[SOIL_PROBE_COUNT];
+	uint16_t levels[SOIL_PROBE_COUNT];
+	uint8_t probe;
+
+	/* Make the measurement. If the probes are still settling, we'll be back. */
+#if SOIL_PROBE_COUNT > 1
+	if (!soil_finish_scan_async(readings)) {
+		return;
+	}
+#else
+	if (!soil_finish_reading_async(&readings[0])) {
+		return;
+	}
+#endif
+
+	/* If the driver learned something new about the probes (over this reading or its settling steps), hang on to it */
+	if (soil_get_settle_time() != settle_ticks) {
+		settle_ticks = soil_get_settle_time();
+		settings_mark_dirty(SETTLE_FLASH_KEY);
+	}
+
+	for (probe = 0; probe < SOIL_PROBE_COUNT; ++probe) {
+		levels[probe] = _report_reading(probe, &readings[probe]);
+	}
+
+	last_measurement = readings[0].mean;
+
+	/* Work out when to look again */
+	_adapt_interval(levels, readings[0].supply_mv);
+
+	/* Only wake up again if something interesting happens */
+	_update_autonomous_window();
+}
+
+/*
+ * @brief Moves the autonomous sampling window to follow the last reading.
+ *
+ * The window watches whichever threshold the first probe's alarm would change at next. While a change
+ * is being debounced, it's shrunk right down so the following readings wake us and can be counted.
+ *
+ * @return void
+ */
+static void _update_autonomous_window() {
+#ifdef AUTONOMOUS_SAMPLING
+	uint16_t threshold = (alarm_state[0] == alarm_set) ? _get_clear_level() : settings.alarm_level;
+
+	soil_update_window(last_measurement, (alarm_pending[0] > 0) ? 1 : settings.autonomous_deadband, calib_from_vwc(0, threshold));
+#endif
+}
+
+/*
+ * @brief Picks the next measurement interval from how the readings are moving and how the battery is doing.
+ *
+ * Autonomous sampling has no interval to pick, so this does nothing there.
+ *
+ * @param levels The reading from each probe, in 0.01 % VWC.
+ * @param supply_mv The supply voltage the readings were taken at. 0 if it wasn't measured.
+ *
+ * @return void
+ */
+static void _adapt_interval(const uint16_t *levels, uint16_t supply_mv) {
+#ifndef AUTONOMOUS_SAMPLING
+	uint16_t next = measurement_interval;
+	uint16_t min_interval = settings.measure_min;
+	uint16_t max_interval = settings.measure_max;
+	uint32_t rate;
+	uint16_t low;
+	uint16_t high;
+	uint16_t delta;
+	bool busy = false;
+	bool steady = true;
+	uint8_t probe;
+	uint8_t i;
+
+	for (probe = 0; probe < SOIL_PROBE_COUNT; ++probe) {
+		/* How fast it's moving since last time, in 0.01 % a minute */
+		if (recent_count > 0) {
+			delta = (levels[probe] > recent[probe][0]) ? (levels[probe] - recent[probe][0]) : (recent[probe][0] - levels[probe]);
+			rate = ((uint32_t) delta * 60) / measurement_interval;
+			busy |= (rate >= ADAPT_RATE);
+			steady &= (rate * 2 < ADAPT_RATE);
+		}
+
+		/* Remember it, newest first */
+		for (i = ADAPT_WINDOW - 1; i > 0; --i) {
+			recent[probe][i] = recent[probe][i - 1];
+		}
+		recent[probe][0] = levels[probe];
+
+		/* And how spread out the last few have been */
+		low = high = levels[probe];
+		for (i = 1; i < recent_count + 1 && i < ADAPT_WINDOW; ++i) {
+			low = (recent[probe][i] < low) ? recent[probe][i] : low;
+			high = (recent[probe][i] > high) ? recent[probe][i] : high;
+		}
+		busy |= ((high - low) >= ADAPT_SPREAD);
+		steady &= ((high - low) * 2 < ADAPT_SPREAD);
+
+		/* Don't keep an alarm change waiting on a long interval */
+		busy |= (alarm_pending[probe] > 0);
+	}
+	if (recent_count < ADAPT_WINDOW) {
+		++recent_count;
+	}
+
+	/* Spend less when the battery is running down */
+	if (supply_mv != 0 && supply_mv < ADAPT_CRITICAL_MV) {
+		min_interval *= 4;
+		max_interval *= 4;
+	} else if (supply_mv != 0 && supply_mv < ADAPT_LOW_MV) {
+		min_interval *= 2;
+		max_interval *= 2;
+	}
+
+	/* Something's happening: look closely. Nothing is: back off. */
+	if (busy) {
+		next = min_interval;
+	} else if (steady) {
+		next = (next > max_interval / 2) ? max_interval : next * 2;
+	}
+	if (next < min_interval) {
+		next = min_interval;
+	} else if (next > max_interval) {
+		next = max_interval;
+	}
 
-	/* Make the measurement */
-	measurement = soil_finish_reading_async();
-	debug_log("ADC Reading: %04X against %04X threshold", measurement, settings.alarm_level);
+	if (next == measurement_interval) {
+		return;
+	}
 
-	/* If we're over the limit... */
-	if (measurement > settings.alarm_level) {
-		debug_log("Sending Alarm.");
+#ifdef BATCH_PUBLISHING
+	/* A batch only has one interval, so send what was taken at the old one */
+	for (probe = 0; probe < SOIL_PROBE_COUNT; ++probe) {
+		if (!friendless && moistsens_batch_publish(probe)) {
+			++publishes_sent;
+		}
+	}
+#endif
 
-		/* Publish the moisture alarm to the group */
-		_publish_moisture(MOIST_ALARM_FLAG);
+	debug_log("Measuring every %ds now.", next);
+	measurement_interval = next;
+	_start_measurement_timer();
+#endif
+}
+
+/*
+ * @brief (Re)starts the measurement timer at the current interval.
+ *
+ * @return void
+ */
+static void _start_measurement_timer() {
+	DEBUG_ASSERT_BGAPI_SUCCESS(
+			gecko_cmd_hardware_set_soft_timer(GET_SOFT_TIMER_COUNTS(measurement_interval), MEASUREMENT_TIMER_HANDLE, SOFT_TIMER_FREE_RUN)
+			->result, "Failed to start measurement timer.");
+}
+
+/*
+ * @brief Checks one probe's reading against the alarm level and reports it.
+ *
+ * Alarm changes go out on the probe's Generic Level element, as the alarm flag when it sets and
+ * as the reading when it clears. The readings themselves go out on the sensor model.
+ *
+ * @param probe Which probe the reading came from.
+ * @param reading The reading to report.
+ *
+ * @return The reading in 0.01 % VWC.
+ */
+static uint16_t _report_reading(uint8_t probe, const soil_reading *reading) {
+	uint16_t measurement = calib_to_vwc(probe, reading->mean);
+	bool changed = _step_alarm(probe, measurement);
+	bool alarm_sent = false;
+
+	/* The valves follow the alarm directly */
+	valve_update(probe, alarm_state[probe] == alarm_set);
+
+	debug_log("ADC Reading %d: %04X (%04X-%04X, n=%d, %lu cycles, %dmV) is %d against %d threshold",
+			probe, reading->mean, reading->min, reading->max, reading->count, reading->cycles, reading->supply_mv,
+			measurement, settings.alarm_level);
+
+	if (alarm_state[probe] == alarm_set) {
+		/* Tell the group when we go off, and remind them every so often if asked to */
+		if (changed || (settings.alarm_reminder != 0 && (_get_seconds() - last_alarm_time[probe]) >= settings.alarm_reminder)) {
+			debug_log("Sending Alarm.");
+			_publish_moisture(MOISTURE_ELEMENT_INDEX + probe, MOIST_ALARM_FLAG);
+			last_alarm_time[probe] = _get_seconds();
+			alarm_sent = true;
+		}
 
 		/* Make the wet (alarmed) prompt */
-		sprintf(prompt_buffer,"Wet: 0x%04X/0x%04X",measurement, settings.alarm_level);
+		sprintf(prompt_buffer,"Wet: %d.%02d%%/%d.%02d%%", measurement / 100, measurement % 100,
+				settings.alarm_level / 100, settings.alarm_level % 100);
 	} else {
+		/* Let the group know it's over */
+		if (changed) {
+			debug_log("Clearing Alarm.");
+			_publish_moisture(MOISTURE_ELEMENT_INDEX + probe, measurement);
+			alarm_sent = true;
+		}
+
 		/* Make the dry (unalarmed) prompt */
-		sprintf(prompt_buffer,"Dry: 0x%04X/0x%04X",measurement, settings.alarm_level);
+		sprintf(prompt_buffer,"Dry: %d.%02d%%/%d.%02d%%", measurement / 100, measurement % 100,
+				settings.alarm_level / 100, settings.alarm_level % 100);
+	}
+
+	/* Write the prompt to the screen. There's only room for the first probe. */
+	if (probe == 0) {
+		LCD_write(prompt_buffer,LCD_ROW_TEMPVALUE);
+	}
+
+	/* Keep the models current for anyone who asks */
+	if (!alarm_sent) {
+		_update_level(MOISTURE_ELEMENT_INDEX + probe, measurement);
+	}
+	moistsens_update(probe, measurement);
+
+	/* Nobody to hear it right now. Keep what would have gone out, and send it once we have a friend again. */
+	if (friendless) {
+#ifdef BATCH_PUBLISHING
+		/* Every reading would have gone out in a batch */
+		history_add(probe, measurement, true);
+#else
+		if (!alarm_sent && _should_publish(probe, measurement, changed)) {
+			history_add(probe, measurement, true);
+			published[probe] = true;
+			last_published[probe] = measurement;
+			last_publish_time[probe] = _get_seconds();
+		} else {
+			history_add(probe, measurement, false);
+			++publishes_suppressed;
+		}
+#endif
+		return measurement;
+	}
+	history_add(probe, measurement, false);
+
+#ifdef BATCH_PUBLISHING
+	/* Save the measurement up until there's a full batch, but send what we have as soon as the alarm changes */
+	if (moistsens_batch_add(probe) || changed) {
+		if (moistsens_batch_publish(probe)) {
+			++publishes_sent;
+		}
+	} else {
+		++publishes_suppressed;
+	}
+#else
+	/* Send the measurement to the group, but only if the cadence says it's due, and never on the same tick as an alarm. */
+	if (!alarm_sent && _should_publish(probe, measurement, changed)) {
+		if (moistsens_publish(probe)) {
+			++publishes_sent;
+		}
+		published[probe] = true;
+		last_published[probe] = measurement;
+		last_publish_time[probe] = _get_seconds();
+	} else {
+		++publishes_suppressed;
+	}
+#endif
+
+	return measurement;
+}
+
+/*
+ * @brief Runs a probe's alarm state machine on a new reading.
+ *
+ * @param probe Which probe the reading came from.
+ * @param level The new reading, in 0.01 % VWC.
+ *
+ * @return True if the alarm state changed.
+ */
+static bool _step_alarm(uint8_t probe, uint16_t level) {
+	bool disagrees;
+
+	/* Set over the alarm level, but don't clear until we're clear of the hysteresis band too */
+	if (alarm_state[probe] == alarm_clear) {
+		disagrees = (level > settings.alarm_level);
+	} else {
+		disagrees = (level < _get_clear_level());
+	}
+
+	/* Anything back on our side of the line starts the count over */
+	if (!disagrees) {
+		alarm_pending[probe] = 0;
+		return false;
+	}
+
+	/* Wait until it's said it enough times in a row */
+	if (++alarm_pending[probe] < settings.alarm_debounce) {
+		return false;
+	}
+
+	alarm_pending[probe] = 0;
+	alarm_state[probe] = (alarm_state[probe] == alarm_clear) ? alarm_set : alarm_clear;
+	debug_log("Probe %d alarm %s.", probe, (alarm_state[probe] == alarm_set) ? "set" : "cleared");
+	return true;
+}
+
+/*
+ * @brief Works out where a set alarm clears.
+ *
+ * @return The clear level in 0.01 % VWC.
+ */
+static uint16_t _get_clear_level() {
+	return (settings.alarm_level > settings.alarm_hysteresis) ? (settings.alarm_level - settings.alarm_hysteresis) : 0;
+}
+
+/*
+ * @brief Applies the publish cadence to a new reading.
+ *
+ * @param probe Which probe the reading came from.
+ * @param level The new reading.
+ * @param crossed Whether the alarm state just changed.
+ *
+ * @return True if the reading should be published.
+ */
+static bool _should_publish(uint8_t probe, uint16_t level, bool crossed) {
+	moist_cadence cadence = settings.cadence;
+	uint32_t elapsed = _get_seconds() - last_publish_time[probe];
+	uint32_t delta;
+	uint32_t trigger;
+	uint32_t rel_trigger;
+	uint32_t period;
+	bool fast;
+
+	/* The first reading always goes out, and so does anything that changes the alarm state */
+	if (!published[probe] || crossed) {
+		return true;
+	}
+
+	/* Don't flood the network, however busy the reading is (rounded up to the next second) */
+	if (elapsed < ((((uint32_t) 1 << cadence.min_interval) + 999) / 1000)) {
+		return false;
+	}
+
+	/* Moved far enough in whichever direction it went, either outright or relative to where it was */
+	if (level < last_published[probe]) {
+		delta = last_published[probe] - level;
+		trigger = cadence.delta_down;
+		rel_trigger = settings.rel_delta_down;
+	} else {
+		delta = level - last_published[probe];
+		trigger = cadence.delta_up;
+		rel_trigger = settings.rel_delta_up;
+	}
+	if (trigger != 0 && delta >= trigger) {
+		return true;
+	}
+	/* Relative triggers are hundredths of a percent of where it was */
+	if (rel_trigger != 0 && delta != 0 && delta * 10000 >= (uint32_t) last_published[probe] * rel_trigger) {
+		return true;
+	}
+
+	/* Or it's been quiet long enough that the network should hear we're still here. Faster in the fast range. */
+	if (cadence.fast_high >= cadence.fast_low) {
+		fast = (level >= cadence.fast_low && level <= cadence.fast_high);
+	} else {
+		fast = (level > cadence.fast_low || level < cadence.fast_high);
+	}
+	period = fast ? (cadence.period >> cadence.fast_divisor) : cadence.period;
+	if (cadence.period != 0 && elapsed >= period) {
+		return true;
+	}
+
+	return false;
+}
+
+/*
+ * @brief Gets the stack's idea of the current time.
+ *
+ * @return Seconds since boot.
+ */
+static uint32_t _get_seconds() {
+	return gecko_cmd_hardware_get_time()->seconds;
+}
+
+/*
+ * @brief Gets the publish cadence the way Sensor Cadence messages carry it.
+ *
+ * @param cadence Where to put the cadence. The deltas are the pair trigger_percent picks.
+ *
+ * @return void
+ */
+void moistsrv_get_cadence(moist_cadence *cadence) {
+	*cadence = settings.cadence;
+	if (cadence->trigger_percent) {
+		cadence->delta_down = settings.rel_delta_down;
+		cadence->delta_up = settings.rel_delta_up;
+	}
+}
+
+/*
+ * @brief Changes the publish cadence and saves it once things settle down.
+ *
+ * @param cadence The new cadence. See PUBLISH_PERIOD and friends for what it all means. The deltas
+ *     replace the pair trigger_percent picks, and the other pair is left as it is.
+ *
+ * @return True if the cadence was taken. False if the divisor or minimum interval are out of range.
+ */
+bool moistsrv_set_cadence(const moist_cadence *cadence) {
+	moist_cadence stored = *cadence;
+
+	if (cadence->trigger_percent) {
+		stored.delta_down = settings.cadence.delta_down;
+		stored.delta_up = settings.cadence.delta_up;
+	}
+	if (!_set_cadence(&stored)) {
+		return false;
+	}
+	if (cadence->trigger_percent) {
+		settings.rel_delta_down = cadence->delta_down;
+		settings.rel_delta_up = cadence->delta_up;
+	}
+	return true;
+}
+
+/*
+ * @brief Changes the publish cadence as it's stored, with the absolute deltas, and saves it once things
+ * settle down.
+ *
+ * @param cadence The new cadence.
+ *
+ * @return True if the cadence was taken. False if the divisor or minimum interval are out of range.
+ */
+static bool _set_cadence(const moist_cadence *cadence) {
+	if (cadence->fast_divisor > PUBLISH_MAX_FAST_DIVISOR || cadence->min_interval > PUBLISH_MAX_MIN_INTERVAL) {
+		return false;
+	}
+
+	settings.cadence = *cadence;
+
+	/* Save the settings once the changes stop coming */
+	settings_mark_dirty(ALARM_FLASH_KEY);
+	return true;
+}
+
+/*
+ * @brief Changes how the alarm state machine behaves and saves it once things settle down.
+ *
+ * @param hysteresis How far (in 0.01 % VWC) under the alarm level a reading has to drop to clear the alarm.
+ * @param debounce How many readings in a row it takes to change the alarm state. 0 and 1 both mean immediately.
+ * @param reminder How often (in seconds) to repeat the alarm while it stays set. 0 for never.
+ *
+ * @return void
+ */
+void moistsrv_set_alarm_policy(uint16_t hysteresis, uint8_t debounce, uint16_t reminder) {
+	settings.alarm_hysteresis = hysteresis;
+	settings.alarm_debounce = debounce;
+	settings.alarm_reminder = reminder;
+
+	/* Save the settings once the changes stop coming */
+	settings_mark_dirty(ALARM_FLASH_KEY);
+}
+
+/*
+ * @brief Changes the bounds on the adaptive measurement interval and saves them once things settle down.
+ *
+ * The new bounds are used from the next reading on.
+ *
+ * @param min_interval The shortest time between measurements, in seconds. At least 1.
+ * @param max_interval The longest time between measurements, in seconds. At least min_interval.
+ *
+ * @return True if the bounds were taken.
+ */
+bool moistsrv_set_measurement_limits(uint16_t min_interval, uint16_t max_interval) {
+	/* The battery scaling can quadruple them, so leave room for that */
+	if (min_interval < 1 || max_interval < min_interval || max_interval > UINT16_MAX / 4) {
+		return false;
+	}
+
+	settings.measure_min = min_interval;
+	settings.measure_max = max_interval;
+
+	/* Save the settings once the changes stop coming */
+	settings_mark_dirty(ALARM_FLASH_KEY);
+	return true;
+}
+
+/*
+ * @brief Gets how often measurements are being taken right now.
+ *
+ * @return The measurement interval in seconds.
+ */
+uint16_t moistsrv_get_measurement_interval() {
+	return measurement_interval;
+}
+
+/*
+ * @brief Reads one of the tunable parameters.
+ *
+ * @param param Which parameter.
+ * @param value Where to put its value, in the units given with moist_params.
+ *
+ * @return True if the parameter exists.
+ */
+bool moistsrv_get_param(moist_params param, uint32_t *value) {
+	switch (param) {
+		case moist_param_alarm_level:
+			*value = settings.alarm_level;
+			break;
+		case moist_param_alarm_counts:
+			*value = calib_from_vwc(0, settings.alarm_level);
+			break;
+		case moist_param_measure_min:
+			*value = settings.measure_min;
+			break;
+		case moist_param_measure_max:
+			*value = settings.measure_max;
+			break;
+		case moist_param_deadband:
+			*value = settings.autonomous_deadband;
+			break;
+		case moist_param_oversampling:
+			*value = settings.sample_count;
+			break;
+		case moist_param_lpn_poll:
+			*value = settings.lpn_poll_timeout;
+			break;
+		case moist_param_publish_period:
+			*value = settings.cadence.period;
+			break;
+		case moist_param_delta_down:
+			*value = settings.cadence.delta_down;
+			break;
+		case moist_param_delta_up:
+			*value = settings.cadence.delta_up;
+			break;
+		case moist_param_min_interval:
+			*value = settings.cadence.min_interval;
+			break;
+		case moist_param_alarm_hysteresis:
+			*value = settings.alarm_hysteresis;
+			break;
+		case moist_param_alarm_debounce:
+			*value = settings.alarm_debounce;
+			break;
+		case moist_param_alarm_reminder:
+			*value = settings.alarm_reminder;
+			break;
+		case moist_param_valve_dead_time:
+			*value = valve_get_dead_time();
+			break;
+		case moist_param_rel_delta_down:
+			*value = settings.rel_delta_down;
+			break;
+		case moist_param_rel_delta_up:
+			*value = settings.rel_delta_up;
+			break;
+		case moist_param_fast_divisor:
+			*value = settings.cadence.fast_divisor;
+			break;
+		case moist_param_fast_low:
+			*value = settings.cadence.fast_low;
+			break;
+		case moist_param_fast_high:
+			*value = settings.cadence.fast_high;
+			break;
+		case moist_param_trigger_percent:
+			*value = settings.cadence.trigger_percent ? 1 : 0;
+			break;
+		default:
+			return false;
 	}
+	return true;
+}
 
-	/* Write the prompt to the screen */
-	LCD_write(prompt_buffer,LCD_ROW_TEMPVALUE);
+/*
+ * @brief Changes one of the tunable parameters, puts it to use, and saves it once things settle down.
+ *
+ * @param param Which parameter.
+ * @param value Its new value, in the units given with moist_params.
+ *
+ * @return True if the parameter exists and the value was taken.
+ */
+bool moistsrv_set_param(moist_params param, uint32_t value) {
+	moist_cadence cadence = settings.cadence;
+	soil_sample_modes mode;
 
-	/* Send the measurement to the group */
-	_publish_moisture(measurement);
+	/* Everything but the poll timeout fits in 16 bits */
+	if (param != moist_param_lpn_poll && value > UINT16_MAX) {
+		return false;
+	}
+
+	switch (param) {
+		case moist_param_alarm_level:
+			_set_alarm_level(value);
+			return true;
+		case moist_param_alarm_counts:
+			_set_alarm_level(calib_to_vwc(0, value));
+			return true;
+		case moist_param_measure_min:
+			return moistsrv_set_measurement_limits(value, settings.measure_max);
+		case moist_param_measure_max:
+			return moistsrv_set_measurement_limits(settings.measure_min, value);
+		case moist_param_deadband:
+			settings.autonomous_deadband = value;
+			_update_autonomous_window();
+			break;
+		case moist_param_oversampling:
+			if (value < 1 || value > SOIL_MAX_SAMPLE_COUNT) {
+				return false;
+			}
+			/* Stay in whatever mode the driver is in. A single conversion is just 1x oversampling, though. */
+			mode = soil_get_sample_mode();
+			if (mode == soil_sample_single && value > 1) {
+				mode = soil_sample_hw_oversample;
+			}
+			soil_set_sampling(mode, value);
+			/* The driver may round it, or not take it at all mid-conversion, so keep what it's really using */
+			if (soil_get_sample_count() != settings.sample_count) {
+				settings.sample_count = soil_get_sample_count();
+				settings_mark_dirty(ALARM_FLASH_KEY);
+			}
+			/* And only call it a success if that's what was asked for */
+			return settings.sample_count == value;
+		case moist_param_lpn_poll:
+			if (value < LPN_MIN_POLL_TIMEOUT || value > LPN_MAX_POLL_TIMEOUT) {
+				return false;
+			}
+			settings.lpn_poll_timeout = value;
+			break;
+		case moist_param_publish_period:
+			cadence.period = value;
+			return _set_cadence(&cadence);
+		case moist_param_delta_down:
+			cadence.delta_down = value;
+			return _set_cadence(&cadence);
+		case moist_param_delta_up:
+			cadence.delta_up = value;
+			return _set_cadence(&cadence);
+		case moist_param_min_interval:
+			if (value > UINT8_MAX) {
+				return false;
+			}
+			cadence.min_interval = value;
+			return _set_cadence(&cadence);
+		case moist_param_alarm_hysteresis:
+			moistsrv_set_alarm_policy(value, settings.alarm_debounce, settings.alarm_reminder);
+			return true;
+		case moist_param_alarm_debounce:
+			if (value > UINT8_MAX) {
+				return false;
+			}
+			moistsrv_set_alarm_policy(settings.alarm_hysteresis, value, settings.alarm_reminder);
+			return true;
+		case moist_param_alarm_reminder:
+			moistsrv_set_alarm_policy(settings.alarm_hysteresis, settings.alarm_debounce, value);
+			return true;
+		case moist_param_valve_dead_time:
+			/* The valve module keeps its own settings */
+			valve_set_dead_time(value);
+			return true;
+		case moist_param_rel_delta_down:
+			settings.rel_delta_down = value;
+			break;
+		case moist_param_rel_delta_up:
+			settings.rel_delta_up = value;
+			break;
+		case moist_param_fast_divisor:
+			if (value > UINT8_MAX) {
+				return false;
+			}
+			cadence.fast_divisor = value;
+			return _set_cadence(&cadence);
+		case moist_param_fast_low:
+			cadence.fast_low = value;
+			return _set_cadence(&cadence);
+		case moist_param_fast_high:
+			cadence.fast_high = value;
+			return _set_cadence(&cadence);
+		case moist_param_trigger_percent:
+			if (value > 1) {
+				return false;
+			}
+			cadence.trigger_percent = (value != 0);
+			return _set_cadence(&cadence);
+		default:
+			return false;
+	}
+
+	/* Save the settings once the changes stop coming */
+	settings_mark_dirty(ALARM_FLASH_KEY);
+	return true;
 }
 
 /*
@@ -519,6 +1349,8 @@ void moistsrv_init() {
 	}
 	/* Prep the sensor library */
 	soil_init(ADC_WAIT_FINISHED);
+	/* Read across the probe and scale to the supply, so the alarm level holds as the battery runs down */
+	soil_set_measure_mode(soil_measure_differential);
 }
 
 /*
@@ -534,7 +1366,12 @@ void moistsrv_handle_events(uint32_t evt_id, struct gecko_cmd_packet *evt) {
 	switch(evt_id) {
 		case gecko_evt_system_external_signal_id:
 			if (evt->data.evt_system_external_signal.extsignals & CORE_EVT_BOOT) {
+	    		/* The calibration goes first, since old alarm levels are converted with it */
+	    		calib_load();
 	    		_load_settings();
+	    		soil_set_sampling(SOIL_DEFAULT_SAMPLE_MODE, settings.sample_count);
+	    		settings.sample_count = soil_get_sample_count();
+	    		_load_settle_time();
 	    		DEBUG_ASSERT_BGAPI_SUCCESS(gecko_cmd_mesh_generic_server_init()
 	    				->result,"Failed to init Generic Mesh Server");
 			}
@@ -549,9 +1386,12 @@ void moistsrv_handle_events(uint32_t evt_id, struct gecko_cmd_packet *evt) {
 				_init_and_register_models();
 
 				/* Start taking measurements */
-		    	DEBUG_ASSERT_BGAPI_SUCCESS(
-		    			gecko_cmd_hardware_set_soft_timer(GET_SOFT_TIMER_COUNTS(MEASUREMENT_TIME), MEASUREMENT_TIMER_HANDLE, SOFT_TIMER_FREE_RUN)
-		    			->result, "Failed to start measurement timer.");
+#ifdef AUTONOMOUS_SAMPLING
+				soil_start_autonomous();
+#else
+				measurement_interval = settings.measure_min;
+				_start_measurement_timer();
+#endif
 
 				/* If we're allowed to go into deep sleep, switch to low power. */
 				if (!disable_deep_sleep) {
@@ -560,11 +1400,22 @@ void moistsrv_handle_events(uint32_t evt_id, struct gecko_cmd_packet *evt) {
 					LCD_write("Fully Awake", LCD_ROW_CONNECTION);
 				}
 			}
+			if(evt->data.evt_system_external_signal.extsignals & ADC_WAIT_FINISHED) {
+				/* The ADC has our reading. Go report it. */
+				_finish_measurement();
+			}
+			if(evt->data.evt_system_external_signal.extsignals & PB_EVT_1) {
+				/* Show how much airtime the publish policy is saving */
+				sprintf(prompt_buffer, "TX %lu SKIP %lu", (unsigned long) publishes_sent, (unsigned long) publishes_suppressed);
+				_toast(prompt_buffer);
+				/* And what the flash and the event dispatch are costing */
+				_log_stats();
+			}
 			if(evt->data.evt_system_external_signal.extsignals & PB_EVT_0) {
 				debug_log("PB0\n");
 				if (meshconn_get_state() == network_ready && ready) {
 					_toast("Forced TX");
-					_publish_moisture(MOIST_ALARM_FLAG);
+					_publish_moisture(MOISTURE_ELEMENT_INDEX, MOIST_ALARM_FLAG);
 				}
 			}
 			break;
@@ -609,7 +1460,9 @@ void moistsrv_handle_events(uint32_t evt_id, struct gecko_cmd_packet *evt) {
 	        debug_log("Maximum Sleep mode: %d\n",SLEEP_LowestEnergyModeGet());
 	    	_toast("Friend Found");
 			LCD_write("Friended", LCD_ROW_CONNECTION);
-	        /* Yay! Friends! Do nothing! */
+	        /* Yay! Friends! Catch them up on what they missed. */
+	        friendless = false;
+	        _start_drain();
 	    	break;
 
 	    case gecko_evt_mesh_lpn_friendship_failed_id:
@@ -620,6 +1473,10 @@ void moistsrv_handle_events(uint32_t evt_id, struct gecko_cmd_packet *evt) {
 	    case gecko_evt_mesh_lpn_friendship_terminated_id:
 	        debug_log("gecko_evt_mesh_lpn_friendship_terminated_id");
 
+	        /* Hold on to readings until we find someone new */
+	        friendless = true;
+	        _stop_drain();
+
 	    	LCD_write("Not Friended", LCD_ROW_CONNECTION);
 	    	_toast("Lost Friend");
 
@@ -630,10 +1487,6 @@ void moistsrv_handle_events(uint32_t evt_id, struct gecko_cmd_packet *evt) {
 
 	    case gecko_evt_hardware_soft_timer_id:
 	    	switch (evt->data.evt_hardware_soft_timer.handle) {
-	    		case SAVE_TIMER_HANDLE:
-	    			/* If we've waited long enough without the settings change being asked for again, commit it to flash. */
-	    			_save_settings();
-	    			break;
 	    		case TOAST_TIMER_HANDLE:
 	    			/* After the toast ends, clear the toast. */
 	    			LCD_write("", LCD_ROW_ACTION);
@@ -642,13 +1495,18 @@ void moistsrv_handle_events(uint32_t evt_id, struct gecko_cmd_packet *evt) {
 	    			/* Retry making friends since we lost our old one or couldn't find one. */
 	    			_get_friend();
 	    			break;
+	    		case DRAIN_TIMER_HANDLE:
+	    			/* Send the next few held back readings. */
+	    			_drain_history();
+	    			break;
 	    		case MEASUREMENT_TIMER_HANDLE:
 	    			/* Make and (if necessary) report the measurement. */
 	    			_do_measurement();
 	    			break;
 	    		case SOIL_POWER_ON_HANDLE:
-					_finish_measurement();
-					break;
+	    			/* The sensor has settled. Start the conversion; ADC_WAIT_FINISHED will follow. */
+	    			soil_start_conversion_async();
+	    			break;
 	    		default:
 	    			break;
 	    	}
@@ -658,3 +1516,28 @@ void moistsrv_handle_events(uint32_t evt_id, struct gecko_cmd_packet *evt) {
 			break;
 	}
 }
+
+/* What moistsrv_handle_events handles, so the router only hands it those */
+static const uint32_t subscribed_events[] = {
+		gecko_evt_mesh_generic_server_client_request_id,
+		gecko_evt_mesh_generic_server_state_changed_id,
+		gecko_evt_le_connection_opened_id,
+		gecko_evt_le_connection_closed_id,
+		gecko_evt_mesh_lpn_friendship_established_id,
+		gecko_evt_mesh_lpn_friendship_failed_id,
+		gecko_evt_mesh_lpn_friendship_terminated_id
+};
+static const uint8_t subscribed_timers[] = {
+		TOAST_TIMER_HANDLE,
+		BEFRIEND_TIMER_HANDLE,
+		DRAIN_TIMER_HANDLE,
+		MEASUREMENT_TIMER_HANDLE,
+		SOIL_POWER_ON_HANDLE
+};
+
+const router_subscription moistsrv_subscription = {
+		moistsrv_handle_events,
+		subscribed_events, ROUTER_COUNT(subscribed_events),
+		subscribed_timers, ROUTER_COUNT(subscribed_timers),
+		CORE_EVT_BOOT | CORE_EVT_POST_BOOT | CORE_EVT_NETWORK_READY | ADC_WAIT_FINISHED | PB_EVT_0 | PB_EVT_1
+};
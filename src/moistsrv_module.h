@@ -11,13 +11,84 @@
 #define SRC_MOISTSRV_MODULE_H_
 
 #include "stdint.h"
+#include "stdbool.h"
 #include "native_gecko.h"
 
+#include "router_module.h"
+
 /* Primary performance tuning parameters. */
-#define MEASUREMENT_TIME (5.000) /* s */
 #define LPN_POLL_TIMEOUT (30000) /* ms */
 #define BEFRIEND_RETRY_DELAY (19.000) /* s */
-#define SAVE_DELAY (10.000) /* s */
+#define DRAIN_TIME (2.000) /* s between backfill messages once we have a friend again */
+
+/*
+ * Adaptive measurement defaults. Measurements start every MEASUREMENT_MIN_TIME, and each reading that
+ * holds steady doubles the interval, up to MEASUREMENT_MAX_TIME. As soon as any probe moves by
+ * ADAPT_RATE a minute, or its last ADAPT_WINDOW readings spread over ADAPT_SPREAD, it's straight back to
+ * the minimum so a watering isn't missed. Steady means under half of both. On a weak battery (below
+ * ADAPT_LOW_MV, then ADAPT_CRITICAL_MV) both limits are doubled, then quadrupled. The limits are saved
+ * with the rest of the settings.
+ */
+#define MEASUREMENT_MIN_TIME (5) /* s */
+#define MEASUREMENT_MAX_TIME (320) /* s */
+#define ADAPT_RATE (20) /* 0.01 % VWC a minute */
+#define ADAPT_WINDOW (4) /* readings */
+#define ADAPT_SPREAD (100) /* 0.01 % VWC */
+#define ADAPT_LOW_MV (2700) /* mV */
+#define ADAPT_CRITICAL_MV (2400) /* mV */
+
+/*
+ * Define this to let the CRYOTIMER take measurements in EM2 (see soil_start_autonomous) instead of
+ * waking on the measurement timer. The CPU then only wakes when the reading moves by more than
+ * AUTONOMOUS_DEADBAND or crosses the alarm level.
+ */
+//#define AUTONOMOUS_SAMPLING
+#define AUTONOMOUS_DEADBAND (0x0040) /* ADC counts */
+
+/*
+ * Define this to save PUBLISH_BATCH_SIZE readings up and publish them as a single batch status
+ * (see moistsens_module.h) instead of going through the publish cadence reading by reading. A change
+ * in the alarm sends whatever has been saved up straight away. The batch has to fit in
+ * MESH_CFG_MAX_SEND_SEGS segments.
+ */
+//#define BATCH_PUBLISHING
+#define PUBLISH_BATCH_SIZE (8) /* readings */
+
+/*
+ * Publish cadence defaults, after the mesh Sensor Cadence state. A reading is published when it has
+ * dropped by PUBLISH_DELTA_DOWN or risen by PUBLISH_DELTA_UP since the last publish, when it has moved
+ * by PUBLISH_REL_DELTA_DOWN or PUBLISH_REL_DELTA_UP relative to the last publish, when the alarm
+ * changes, or when nothing has gone out for PUBLISH_PERIOD. While the reading is in the fast cadence
+ * range the period is divided by 2^PUBLISH_FAST_DIVISOR. The range runs from PUBLISH_FAST_LOW up to
+ * PUBLISH_FAST_HIGH, or if high is below low, it's everything above low or below high. Apart from alarm
+ * changes, nothing goes out within 2^PUBLISH_MIN_INTERVAL ms of the last publish. The deltas and period
+ * can be set to 0 to turn that rule off. These are saved with the rest of the settings.
+ *
+ * Sensor Cadence messages only carry one pair of deltas, so PUBLISH_TRIGGER_PERCENT picks which pair
+ * they read and write. Both pairs are always checked.
+ */
+#define PUBLISH_PERIOD (300) /* s */
+#define PUBLISH_FAST_DIVISOR (2) /* log2 */
+#define PUBLISH_TRIGGER_PERCENT (false) /* Sensor Cadence carries the absolute deltas, or if true, the relative ones */
+#define PUBLISH_DELTA_DOWN (50) /* 0.01 % VWC */
+#define PUBLISH_DELTA_UP (50) /* 0.01 % VWC */
+#define PUBLISH_REL_DELTA_DOWN (500) /* 0.01 % of the last published value */
+#define PUBLISH_REL_DELTA_UP (500) /* 0.01 % of the last published value */
+#define PUBLISH_MIN_INTERVAL (12) /* log2 ms, so about 4 s */
+#define PUBLISH_FAST_LOW (3000) /* 0.01 % VWC */
+#define PUBLISH_FAST_HIGH (1000) /* 0.01 % VWC */
+#define PUBLISH_MAX_FAST_DIVISOR (15)
+#define PUBLISH_MAX_MIN_INTERVAL (26)
+
+/*
+ * Alarm state machine defaults. The alarm sets when the reading goes over the alarm level and only
+ * clears once it drops ALARM_HYSTERESIS below it, and either way the new state has to hold for
+ * ALARM_DEBOUNCE readings in a row first. The alarm is only published when it changes, plus every
+ * ALARM_REMINDER while it stays set (0 for never). These are saved with the rest of the settings.
+ */
+#define ALARM_HYSTERESIS (200) /* 0.01 % VWC */
+#define ALARM_DEBOUNCE (3) /* readings */
+#define ALARM_REMINDER (0) /* s */
 
 /* How long to keep temporary notices (toasts) on the screen */
 #define TOAST_DURATION (3.000) /* s */
@@ -26,14 +97,67 @@
 
 #define LPN_QUEUE_DEPTH (4) /* We use 4 because the defaults allow for up to 5 */
 #define MOISTURE_ELEMENT_INDEX (0) /* Why 0? Because their system doesn't currently make an element array constant. >.< */
+/* With more than one probe (see SOIL_PROBES), probe n is published on element MOISTURE_ELEMENT_INDEX + n */
 
 #define MOISTSRV_TIMER_HANDLE_BASE (10)
-#define SAVE_TIMER_HANDLE (MOISTSRV_TIMER_HANDLE_BASE + 0)
 #define TOAST_TIMER_HANDLE (MOISTSRV_TIMER_HANDLE_BASE + 1)
 #define BEFRIEND_TIMER_HANDLE (MOISTSRV_TIMER_HANDLE_BASE + 2)
 #define MEASUREMENT_TIMER_HANDLE (MOISTSRV_TIMER_HANDLE_BASE + 3)
+#define DRAIN_TIMER_HANDLE (MOISTSRV_TIMER_HANDLE_BASE + 4)
+
+typedef struct {
+	uint16_t period; /* s */
+	uint8_t fast_divisor; /* log2 */
+	bool trigger_percent; /* Whether the deltas are the relative pair */
+	uint16_t delta_down;
+	uint16_t delta_up;
+	uint8_t min_interval; /* log2 ms */
+	uint16_t fast_low; /* 0.01 % VWC */
+	uint16_t fast_high; /* 0.01 % VWC */
+} moist_cadence;
+
+/*
+ * Everything that can be tuned at runtime (see moistsrv_set_param), in native units. These are also
+ * the parameter IDs on the wire for the configuration model, so don't renumber them.
+ */
+typedef enum {
+	moist_param_alarm_level = 0x01, /* 0.01 % VWC */
+	moist_param_alarm_counts = 0x02, /* Raw probe counts, through the first probe's calibration */
+	moist_param_measure_min = 0x03, /* s */
+	moist_param_measure_max = 0x04, /* s */
+	moist_param_deadband = 0x05, /* ADC counts, for autonomous sampling */
+	moist_param_oversampling = 0x06, /* Conversions per reading */
+	moist_param_lpn_poll = 0x07, /* ms. Used from the next friendship on. */
+	moist_param_publish_period = 0x08, /* s */
+	moist_param_delta_down = 0x09, /* 0.01 % VWC */
+	moist_param_delta_up = 0x0A, /* 0.01 % VWC */
+	moist_param_min_interval = 0x0B, /* log2 ms */
+	moist_param_alarm_hysteresis = 0x0C, /* 0.01 % VWC */
+	moist_param_alarm_debounce = 0x0D, /* Readings */
+	moist_param_alarm_reminder = 0x0E, /* s */
+	moist_param_valve_dead_time = 0x0F, /* s */
+	moist_param_rel_delta_down = 0x10, /* 0.01 % of the last published value */
+	moist_param_rel_delta_up = 0x11, /* 0.01 % of the last published value */
+	moist_param_fast_divisor = 0x12, /* log2 */
+	moist_param_fast_low = 0x13, /* 0.01 % VWC */
+	moist_param_fast_high = 0x14, /* 0.01 % VWC */
+	moist_param_trigger_percent = 0x15 /* 1 if Sensor Cadence messages carry the relative deltas, 0 for absolute */
+} moist_params;
+
+/* What the LPN poll timeout can be set to, from the mesh profile */
+#define LPN_MIN_POLL_TIMEOUT (1000) /* ms */
+#define LPN_MAX_POLL_TIMEOUT (345599000) /* ms */
 
 void moistsrv_init();
 void moistsrv_handle_events(uint32_t evt_id, struct gecko_cmd_packet *evt);
 
+extern const router_subscription moistsrv_subscription;
+void moistsrv_get_cadence(moist_cadence *cadence);
+bool moistsrv_set_cadence(const moist_cadence *cadence);
+void moistsrv_set_alarm_policy(uint16_t hysteresis, uint8_t debounce, uint16_t reminder);
+bool moistsrv_set_measurement_limits(uint16_t min_interval, uint16_t max_interval);
+uint16_t moistsrv_get_measurement_interval();
+bool moistsrv_get_param(moist_params param, uint32_t *value);
+bool moistsrv_set_param(moist_params param, uint32_t value);
+
 #endif /* SRC_MOISTSRV_MODULE_H_ */
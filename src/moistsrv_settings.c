@@ -0,0 +1,58 @@
+/*
+ * @file moistsrv_settings.c
+ * @brief Moisture Server Settings. The layout of the moisture server's settings record, and how
+ *     records saved by older firmware are brought forward.
+ *
+ * @author agent
+ * @date Oct 16, 2026
+ */
+
+/* Standard Libraries */
+#include "stdint.h"
+#include "stdbool.h"
+#include "string.h"
+
+#include "moistsrv_settings.h"
+#include "calib_module.h"
+
+/*
+ * @brief Brings settings saved by an older version forward. Registered with the settings store.
+ *
+ * Before the settings store, the settings were saved raw, and only held the alarm level, in raw counts
+ * from before calibration; the calibration has to be loaded first so it can be converted. LEGACY_NO_ALARM
+ * meant there was no alarm, and isn't a reading, so it stays that way instead of being converted.
+ * Versions 1 and 2 are version 3 without the fields on the end, which keep their defaults. They only
+ * had one pair of deltas, absolute or relative depending on trigger_percent, so that pair moves to
+ * where it belongs and the other is turned off to keep publishing the way it was.
+ *
+ * @param version The version of the old settings.
+ * @param old The old settings.
+ * @param len How long the old settings are.
+ * @param data Our settings, holding the defaults.
+ *
+ * @return True if anything could be used.
+ */
+bool moistsrv_migrate_settings(uint8_t version, const uint8_t *old, uint8_t len, void *data) {
+	moistsrv_settings *current = data;
+	uint16_t raw;
+
+	if (version == 0 && len == sizeof(uint16_t)) {
+		raw = (uint16_t) (old[0] | (old[1] << 8));
+		current->alarm_level = (raw == LEGACY_NO_ALARM) ? DEFAULT_ALARM_LEVEL : calib_to_vwc(0, raw);
+		return true;
+	}
+	if ((version == 1 && len == MOISTSRV_SETTINGS_V1_SIZE) || (version == 2 && len == MOISTSRV_SETTINGS_V2_SIZE)) {
+		memcpy(current, old, len);
+		if (current->cadence.trigger_percent) {
+			current->rel_delta_down = current->cadence.delta_down;
+			current->rel_delta_up = current->cadence.delta_up;
+			current->cadence.delta_down = 0;
+			current->cadence.delta_up = 0;
+		} else {
+			current->rel_delta_down = 0;
+			current->rel_delta_up = 0;
+		}
+		return true;
+	}
+	return false;
+}
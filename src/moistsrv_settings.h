@@ -0,0 +1,56 @@
+/*
+ * @file moistsrv_settings.h
+ * @brief Moisture Server Settings. The layout of the moisture server's settings record, and how
+ *     records saved by older firmware are brought forward.
+ *
+ * @author agent
+ * @date Oct 16, 2026
+ */
+
+#ifndef SRC_MOISTSRV_SETTINGS_H_
+#define SRC_MOISTSRV_SETTINGS_H_
+
+#include "stdint.h"
+#include "stdbool.h"
+#include "stddef.h"
+
+#include "bg_types.h"
+
+#include "moistsrv_module.h"
+
+/* Bump this whenever moistsrv_settings changes shape, and teach moistsrv_migrate_settings about the old one */
+#define MOISTSRV_SETTINGS_VERSION (3)
+
+#define DEFAULT_ALARM_LEVEL (0x7FFF) /* Above any VWC, so there's no alarm until one is set */
+#define LEGACY_NO_ALARM (0x7FFF) /* What firmware from before the settings store saved when no alarm was set */
+
+/*
+ * Using PACKSTRCT so we don't end up with a bunch of wasted memory.
+ * The price we pay is access delays since the struct's members aren't
+ * going to be aligned, but we're not doing a lot with this struct, so
+ * longer access times are okay.
+ */
+typedef PACKSTRUCT(struct {
+	uint16_t alarm_level;
+	moist_cadence cadence; /* The deltas in here are always the absolute pair */
+	uint16_t alarm_hysteresis;
+	uint8_t alarm_debounce;
+	uint16_t alarm_reminder;
+	uint16_t measure_min;
+	uint16_t measure_max;
+	/* Added in version 2 */
+	uint16_t autonomous_deadband;
+	uint16_t sample_count;
+	uint32_t lpn_poll_timeout;
+	/* Added in version 3 */
+	uint16_t rel_delta_down;
+	uint16_t rel_delta_up;
+}) moistsrv_settings;
+
+/* Version 1 stopped short of autonomous_deadband, and version 2 short of rel_delta_down */
+#define MOISTSRV_SETTINGS_V1_SIZE (offsetof(moistsrv_settings, autonomous_deadband))
+#define MOISTSRV_SETTINGS_V2_SIZE (offsetof(moistsrv_settings, rel_delta_down))
+
+bool moistsrv_migrate_settings(uint8_t version, const uint8_t *old, uint8_t len, void *data);
+
+#endif /* SRC_MOISTSRV_SETTINGS_H_ */
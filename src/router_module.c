@@ -0,0 +1,183 @@
+/*
+ * @file router_module.c
+ * @brief Router Module. Hands each BGAPI event only to the modules that asked for it, instead of
+ *     running every event through every module's event handler.
+ *
+ * @author agent
+ * @date Oct 15, 2026
+ */
+
+/* Standard Libraries */
+#include "stdint.h"
+#include "stdbool.h"
+#include "string.h"
+
+/* Bluetooth stack headers */
+#include "bg_types.h"
+#include "native_gecko.h"
+
+/* For the cycle counter */
+#include "em_device.h"
+
+#include "router_module.h"
+
+#include "debug.h"
+#include "utils_bt.h"
+
+/* Which handlers (one bit each, in subscription order) want an event ID. No handlers means unused. */
+typedef struct {
+	uint32_t evt_id;
+	uint8_t handlers;
+} router_slot;
+
+static router_handler handlers[ROUTER_MAX_HANDLERS];
+static uint8_t handler_count = 0;
+static router_slot events[ROUTER_EVENT_SLOTS];
+static uint8_t timers[ROUTER_MAX_TIMER_HANDLES];
+static uint32_t signals[ROUTER_MAX_HANDLERS];
+static router_stats stats;
+
+static router_slot *_find_slot(uint32_t evt_id, bool create);
+
+/*
+ * @brief Finds an event ID's slot in the table.
+ *
+ * @param evt_id The event ID.
+ * @param create Whether to take a free slot for it if it isn't there yet.
+ *
+ * @return The slot, or NULL if it isn't there (and couldn't be added).
+ */
+static router_slot *_find_slot(uint32_t evt_id, bool create) {
+	uint8_t index = (evt_id * 2654435761u) >> (32 - ROUTER_EVENT_BITS);
+	router_slot *slot;
+	uint8_t n;
+
+	for (n = 0; n < ROUTER_EVENT_SLOTS; ++n) {
+		slot = &events[(index + n) & (ROUTER_EVENT_SLOTS - 1)];
+		if (slot->handlers == 0) {
+			/* Nothing past a free slot; this is where it would have gone */
+			if (!create) {
+				return NULL;
+			}
+			slot->evt_id = evt_id;
+			return slot;
+		}
+		if (slot->evt_id == evt_id) {
+			return slot;
+		}
+	}
+	return NULL;
+}
+
+/*
+ * @brief Clears out the subscriptions and starts the cycle counter.
+ *
+ * @return void
+ */
+void router_init() {
+	handler_count = 0;
+	memset(events, 0, sizeof(events));
+	memset(timers, 0, sizeof(timers));
+	memset(signals, 0, sizeof(signals));
+	memset(&stats, 0, sizeof(stats));
+
+	enable_cycle_counter();
+}
+
+/*
+ * @brief Adds a module's handler to the table. Handlers are called in the order they subscribed.
+ *
+ * @param subscription What the module wants to hear about.
+ *
+ * @return True if it all fit.
+ */
+bool router_subscribe(const router_subscription *subscription) {
+	router_slot *slot;
+	uint8_t bit;
+	uint8_t i;
+
+	if (handler_count >= ROUTER_MAX_HANDLERS) {
+		debug_log("Too many event handlers.");
+		return false;
+	}
+	bit = 1 << handler_count;
+
+	for (i = 0; i < subscription->timer_count; ++i) {
+		if (subscription->timers[i] >= ROUTER_MAX_TIMER_HANDLES) {
+			debug_log("Timer handle %d is past ROUTER_MAX_TIMER_HANDLES.", subscription->timers[i]);
+			return false;
+		}
+	}
+
+	for (i = 0; i < subscription->event_count; ++i) {
+		slot = _find_slot(subscription->events[i], true);
+		if (slot == NULL) {
+			debug_log("Out of event slots.");
+			return false;
+		}
+		slot->handlers |= bit;
+	}
+	for (i = 0; i < subscription->timer_count; ++i) {
+		timers[subscription->timers[i]] |= bit;
+	}
+	signals[handler_count] = subscription->signals;
+	handlers[handler_count++] = subscription->handler;
+	return true;
+}
+
+/*
+ * @brief Hands an event to each module that subscribed to it.
+ *
+ * @param evt The event.
+ *
+ * @return void
+ */
+void router_dispatch(struct gecko_cmd_packet *evt) {
+	uint32_t evt_id = BGLIB_MSG_ID(evt->header);
+	uint32_t start = DWT->CYCCNT;
+	router_slot *slot = _find_slot(evt_id, false);
+	uint8_t mask = (slot != NULL) ? slot->handlers : 0;
+	uint32_t cycles;
+	uint8_t i;
+
+	if (evt_id == gecko_evt_hardware_soft_timer_id) {
+		if (evt->data.evt_hardware_soft_timer.handle < ROUTER_MAX_TIMER_HANDLES) {
+			mask |= timers[evt->data.evt_hardware_soft_timer.handle];
+		}
+	} else if (evt_id == gecko_evt_system_external_signal_id) {
+		for (i = 0; i < handler_count; ++i) {
+			if (signals[i] & evt->data.evt_system_external_signal.extsignals) {
+				mask |= 1 << i;
+			}
+		}
+	}
+
+	/* Only the lookup counts; the handlers cost what they cost either way */
+	cycles = DWT->CYCCNT - start;
+	++stats.events;
+	stats.cycles += cycles;
+	if (cycles > stats.max_cycles) {
+		stats.max_cycles = cycles;
+	}
+	if (mask == 0) {
+		++stats.unrouted;
+		return;
+	}
+
+	for (i = 0; mask != 0; ++i, mask >>= 1) {
+		if (mask & 1) {
+			handlers[i](evt_id, evt);
+		}
+	}
+}
+
+/*
+ * @brief Gets how many events have gone through and what finding their subscribers cost.
+ *
+ * @param out Where to put the statistics.
+ *
+ * @return void
+ */
+void router_get_stats(router_stats *out) {
+	*out = stats;
+}
@@ -0,0 +1,56 @@
+/*
+ * @file router_module.h
+ * @brief Router Module. Hands each BGAPI event only to the modules that asked for it, instead of
+ *     running every event through every module's event handler.
+ *
+ * @author agent
+ * @date Oct 15, 2026
+ */
+
+#ifndef SRC_ROUTER_MODULE_H_
+#define SRC_ROUTER_MODULE_H_
+
+#include "stdint.h"
+#include "stdbool.h"
+#include "native_gecko.h"
+
+/*
+ * Table sizes. ROUTER_EVENT_SLOTS has to be a power of two, and should stay comfortably above the
+ * number of different event IDs subscribed to so lookups don't have to probe far.
+ */
+#define ROUTER_MAX_HANDLERS (8)
+#define ROUTER_EVENT_BITS (5)
+#define ROUTER_EVENT_SLOTS (1 << ROUTER_EVENT_BITS)
+#define ROUTER_MAX_TIMER_HANDLES (48) /* Soft timer handles from 0 up to this */
+
+#define ROUTER_COUNT(array) (sizeof(array) / sizeof((array)[0]))
+
+typedef void (*router_handler)(uint32_t evt_id, struct gecko_cmd_packet *evt);
+
+/*
+ * What a module wants to hear about. Soft timer events go to the modules that own the timer's handle,
+ * and external signal events to the modules listening for any of the signal bits, so neither needs its
+ * event ID listed as well.
+ */
+typedef struct {
+	router_handler handler;
+	const uint32_t *events; /* Event IDs */
+	uint8_t event_count;
+	const uint8_t *timers; /* Soft timer handles */
+	uint8_t timer_count;
+	uint32_t signals; /* External signal bits */
+} router_subscription;
+
+typedef struct {
+	uint32_t events; /* Events dispatched */
+	uint32_t unrouted; /* Events nobody had subscribed to */
+	uint64_t cycles; /* CPU cycles spent finding the subscribers, in total */
+	uint32_t max_cycles; /* The most spent on any one event */
+} router_stats;
+
+void router_init();
+bool router_subscribe(const router_subscription *subscription);
+void router_dispatch(struct gecko_cmd_packet *evt);
+void router_get_stats(router_stats *stats);
+
+#endif /* SRC_ROUTER_MODULE_H_ */
@@ -0,0 +1,332 @@
+/*
+ * @file settings_module.c
+ * @brief Settings Module. Keeps the other modules' settings in flash, each on its own PS key,
+ *     with a version and CRC, and holds back writes so a burst of changes costs one write per record.
+ *
+ * @author agent
+ * @date Oct 15, 2026
+ */
+
+/* Standard Libraries */
+#include "stdint.h"
+#include "stdbool.h"
+#include "string.h"
+
+/* Bluetooth stack headers */
+#include "bg_types.h"
+#include "native_gecko.h"
+
+#include "settings_module.h"
+
+#include "utils_bt.h"
+#include "debug.h"
+
+/* What goes in front of every record in flash. The CRC covers the version and the record. */
+typedef PACKSTRUCT(struct {
+	uint8_t magic;
+	uint8_t version;
+	uint16_t crc;
+}) settings_header;
+
+/* The PS keys top out at 56 bytes */
+#define SETTINGS_MAX_SIZE (56 - sizeof(settings_header))
+
+typedef struct {
+	uint16_t key;
+	uint8_t version;
+	uint8_t size;
+	void *data;
+	settings_migrate_fn migrate;
+	bool dirty;
+	bool stored; /* Whether stored_crc is what's in flash */
+	uint16_t stored_crc;
+} settings_record;
+
+static settings_record records[SETTINGS_MAX_RECORDS];
+static uint8_t record_count = 0;
+static settings_stats stats;
+
+static settings_record *_find(uint16_t key);
+static bool _write(settings_record *record);
+static uint16_t _crc(uint8_t version, const uint8_t *data, uint8_t len);
+
+/*
+ * @brief Finds a registered record.
+ *
+ * @param key The record's PS key.
+ *
+ * @return The record, or NULL if it was never registered.
+ */
+static settings_record *_find(uint16_t key) {
+	uint8_t i;
+
+	for (i = 0; i < record_count; ++i) {
+		if (records[i].key == key) {
+			return &records[i];
+		}
+	}
+	return NULL;
+}
+
+/*
+ * @brief Writes a record to flash, unless flash already has exactly that.
+ *
+ * @param record The record to write.
+ *
+ * @return True if the record is safely in flash.
+ */
+static bool _write(settings_record *record) {
+	uint8_t buffer[sizeof(settings_header) + SETTINGS_MAX_SIZE];
+	settings_header header;
+	errorcode_t result;
+
+	header.magic = SETTINGS_MAGIC;
+	header.version = record->version;
+	header.crc = _crc(record->version, record->data, record->size);
+
+	/* Nothing to do if it's been changed back */
+	if (record->stored && record->stored_crc == header.crc) {
+		++stats.unchanged;
+		return true;
+	}
+
+	memcpy(buffer, &header, sizeof(header));
+	memcpy(&buffer[sizeof(header)], record->data, record->size);
+	result = gecko_cmd_flash_ps_save(record->key, sizeof(header) + record->size, buffer)->result;
+	if (result != bg_err_success) {
+		debug_log("Failed to save settings 0x%04X. Result: 0x%04X", record->key, result);
+		return false;
+	}
+
+	record->stored = true;
+	record->stored_crc = header.crc;
+	++stats.writes;
+	debug_log("Settings 0x%04X saved.", record->key);
+	return true;
+}
+
+/*
+ * @brief CRC-16/CCITT (0x1021, starting at 0xFFFF) over a record's version and contents.
+ *
+ * @param version The record's version.
+ * @param data The record.
+ * @param len How long the record is.
+ *
+ * @return The CRC.
+ */
+static uint16_t _crc(uint8_t version, const uint8_t *data, uint8_t len) {
+	uint16_t crc = 0xFFFF;
+	uint8_t byte = version;
+	uint8_t i;
+	int16_t n;
+
+	/* The version goes first, then the record */
+	for (n = -1; n < len; ++n) {
+		if (n >= 0) {
+			byte = data[n];
+		}
+		crc ^= (uint16_t) byte << 8;
+		for (i = 0; i < 8; ++i) {
+			crc = (crc & 0x8000) ? ((crc << 1) ^ 0x1021) : (crc << 1);
+		}
+	}
+
+	return crc;
+}
+
+/*
+ * @brief Puts a module's settings under the store's care.
+ *
+ * @param key The PS key the settings live on.
+ * @param version The version of the settings' layout. Bump it whenever the layout changes. At least 1.
+ * @param data The settings. Must stay put for as long as the program runs.
+ * @param size How big the settings are.
+ * @param migrate How to bring older versions forward. NULL to just use the defaults.
+ *
+ * @return True if the record was registered.
+ */
+bool settings_register(uint16_t key, uint8_t version, void *data, uint8_t size, settings_migrate_fn migrate) {
+	settings_record *record = _find(key);
+
+	if (version == 0 || size > SETTINGS_MAX_SIZE) {
+		return false;
+	}
+	if (record == NULL) {
+		if (record_count >= SETTINGS_MAX_RECORDS) {
+			return false;
+		}
+		record = &records[record_count++];
+	}
+
+	memset(record, 0, sizeof(settings_record));
+	record->key = key;
+	record->version = version;
+	record->data = data;
+	record->size = size;
+	record->migrate = migrate;
+	return true;
+}
+
+/*
+ * @brief Loads a record from flash over its defaults.
+ *
+ * The record keeps whatever is already in it (the defaults) if flash has nothing usable. Records from
+ * another version are handed to the migrate function, and the result is written back in the new
+ * layout at the next save.
+ *
+ * @param key The record's PS key.
+ *
+ * @return True if the record was loaded from flash.
+ */
+bool settings_load(uint16_t key) {
+	settings_record *record = _find(key);
+	struct gecko_msg_flash_ps_load_rsp_t *result;
+	settings_header header;
+	const uint8_t *payload;
+	uint8_t len;
+	uint8_t version = 0;
+
+	if (record == NULL) {
+		return false;
+	}
+
+	result = gecko_cmd_flash_ps_load(key);
+	if (result->result != bg_err_success) {
+		return false;
+	}
+	payload = result->value.data;
+	len = result->value.len;
+
+	/* Anything without a good header is from before the store */
+	if (len >= sizeof(header)) {
+		memcpy(&header, payload, sizeof(header));
+		if (header.magic == SETTINGS_MAGIC
+				&& header.crc == _crc(header.version, &payload[sizeof(header)], len - sizeof(header))) {
+			version = header.version;
+			payload += sizeof(header);
+			len -= sizeof(header);
+		}
+	}
+
+	/* The easy case */
+	if (version == record->version && len == record->size) {
+		memcpy(record->data, payload, len);
+		record->stored = true;
+		record->stored_crc = header.crc;
+		return true;
+	}
+
+	/* Otherwise see if it can be brought forward */
+	if (record->migrate == NULL || !record->migrate(version, payload, len, record->data)) {
+		debug_log("Settings 0x%04X are unusable (version %d, %d bytes).", key, version, len);
+		return false;
+	}
+
+	debug_log("Settings 0x%04X migrated from version %d.", key, version);
+	settings_mark_dirty(key);
+	return true;
+}
+
+/*
+ * @brief Notes that a record has changed, and (re)starts the wait before it's written.
+ *
+ * @param key The record's PS key.
+ *
+ * @return void
+ */
+void settings_mark_dirty(uint16_t key) {
+	settings_record *record = _find(key);
+
+	if (record == NULL) {
+		return;
+	}
+
+	record->dirty = true;
+	++stats.requests;
+
+	/* Give any other changes in the burst a chance to catch up */
+	DEBUG_ASSERT_BGAPI_SUCCESS(
+			gecko_cmd_hardware_set_soft_timer(GET_SOFT_TIMER_COUNTS(SETTINGS_SAVE_DELAY), SETTINGS_SAVE_TIMER_HANDLE, SOFT_TIMER_ONE_SHOT)
+			->result, "Failed to start settings save timer.");
+}
+
+/*
+ * @brief Removes a record from flash. Its contents in RAM are left alone.
+ *
+ * @param key The record's PS key.
+ *
+ * @return void
+ */
+void settings_erase(uint16_t key) {
+	settings_record *record = _find(key);
+
+	gecko_cmd_flash_ps_erase(key);
+	if (record != NULL) {
+		record->dirty = false;
+		record->stored = false;
+	}
+}
+
+/*
+ * @brief Writes every changed record now, one PS key at a time. Good to do before a reset.
+ *
+ * @return void
+ */
+void settings_flush() {
+	uint8_t i;
+
+	for (i = 0; i < record_count; ++i) {
+		/* Anything that fails stays dirty and is tried again next time */
+		if (records[i].dirty && _write(&records[i])) {
+			records[i].dirty = false;
+		}
+	}
+
+	debug_log("Settings: %lu changes, %lu writes, %lu unchanged.", stats.requests, stats.writes, stats.unchanged);
+}
+
+/*
+ * @brief Gets how much flash writing the store has done and saved.
+ *
+ * @param out Where to put the statistics.
+ *
+ * @return void
+ */
+void settings_get_stats(settings_stats *out) {
+	*out = stats;
+}
+
+/*
+ * @brief Responds to events generated by the BGAPI message queue
+ * that are related to the settings module.
+ *
+ * @param evt_id The ID of the event.
+ * @param evt A pointer to the structure holding the event data.
+ *
+ * @return void
+ */
+void settings_handle_events(uint32_t evt_id, struct gecko_cmd_packet *evt) {
+	switch(evt_id) {
+		case gecko_evt_hardware_soft_timer_id:
+			if (evt->data.evt_hardware_soft_timer.handle == SETTINGS_SAVE_TIMER_HANDLE) {
+				/* Things have gone quiet; write out everything that changed */
+				settings_flush();
+			}
+			break;
+
+		default:
+			break;
+	}
+}
+
+/* What settings_handle_events handles, so the router only hands it those */
+static const uint8_t subscribed_timers[] = {
+		SETTINGS_SAVE_TIMER_HANDLE
+};
+
+const router_subscription settings_subscription = {
+		settings_handle_events,
+		NULL, 0,
+		subscribed_timers, ROUTER_COUNT(subscribed_timers),
+		0
+};
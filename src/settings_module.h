@@ -0,0 +1,63 @@
+/*
+ * @file settings_module.h
+ * @brief Settings Module. Keeps the other modules' settings in flash, each on its own PS key,
+ *     with a version and CRC, and holds back writes so a burst of changes costs one write per record.
+ *
+ * @author agent
+ * @date Oct 15, 2026
+ */
+
+#ifndef SRC_SETTINGS_MODULE_H_
+#define SRC_SETTINGS_MODULE_H_
+
+#include "stdint.h"
+#include "stdbool.h"
+#include "native_gecko.h"
+
+#include "router_module.h"
+
+/*
+ * Changed records are written SETTINGS_SAVE_DELAY after the last change to any of them. Every record is
+ * its own PS key, so each changed one is its own flash write: a burst that touches the moisture server's
+ * settings and the valve's costs two. Settings that usually change together belong in one record.
+ * A record that ends up the same as what's already in flash isn't written at all.
+ */
+#define SETTINGS_SAVE_DELAY (10.000) /* s */
+#define SETTINGS_MAX_RECORDS (8)
+
+/* Every record is stored behind this header. Anything without one predates the store and is version 0. */
+#define SETTINGS_MAGIC (0x5E)
+
+#define SETTINGS_TIMER_HANDLE_BASE (20)
+#define SETTINGS_SAVE_TIMER_HANDLE (SETTINGS_TIMER_HANDLE_BASE + 0)
+
+/*
+ * Called when a record in flash is from another version. Should fill in data (which already holds the
+ * defaults) from the old record.
+ *
+ * @param version The version of the old record. 0 for one that predates the store.
+ * @param old The old record, without the header.
+ * @param len How long the old record is.
+ * @param data The record to fill in.
+ *
+ * @return True if the old record could be used.
+ */
+typedef bool (*settings_migrate_fn)(uint8_t version, const uint8_t *old, uint8_t len, void *data);
+
+typedef struct {
+	uint32_t requests; /* Times a record was marked changed */
+	uint32_t writes; /* Records actually written to flash */
+	uint32_t unchanged; /* Records that turned out not to need writing */
+} settings_stats;
+
+bool settings_register(uint16_t key, uint8_t version, void *data, uint8_t size, settings_migrate_fn migrate);
+bool settings_load(uint16_t key);
+void settings_mark_dirty(uint16_t key);
+void settings_erase(uint16_t key);
+void settings_flush();
+void settings_get_stats(settings_stats *stats);
+void settings_handle_events(uint32_t evt_id, struct gecko_cmd_packet *evt);
+
+extern const router_subscription settings_subscription;
+
+#endif /* SRC_SETTINGS_MODULE_H_ */
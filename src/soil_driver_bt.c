@@ -22,6 +22,10 @@
 #include "em_device.h"
 #include "em_adc.h"
 #include "em_gpio.h"
+#include "em_prs.h"
+#include "em_cryotimer.h"
+#include "native_gecko.h"
+#include <sleep.h>
 
 #include "debug.h"
 #include "utils_bt.h"
@@ -32,75 +36,729 @@ static void _power_on_sensor();
 static void _power_off_sensor();
 static void _ready();
 static void _unready();
+static void _shutdown_adc();
+static void _build_config();
+static void _begin_accumulating();
+static bool _accumulate(uint16_t sample);
+static void _collect(soil_reading *reading);
+static void _start_dma();
+static void _stop_dma();
+static void _collect_dma(soil_reading *reading);
+static void _ready_autonomous();
+static void _set_window(uint16_t low, uint16_t high);
+static uint32_t _now();
+static bool _settle_step(uint16_t mean);
+static bool _finish_settle_step();
+static void _start_power_on();
+static uint16_t _to_12_bits(uint32_t sample, bool signed_result);
+static void _collect_scan(soil_reading readings[SOIL_PROBE_COUNT]);
+static void _measure_supply();
+static void _start_probe_conversion();
+static void _normalize(soil_reading *reading);
+static uint16_t _scale_to_supply(uint16_t counts);
 
+#if SOIL_PROBE_COUNT > SOIL_MAX_SCAN_PROBES
+#error "A scan can't take more probes than the ADC scan FIFO holds."
+#endif
+
+/* The probes we're wired to. Single readings use the first one. */
+static const soil_probe probes[SOIL_PROBE_COUNT] = SOIL_PROBES;
+
+/* The external signal to raise when a conversion completes. */
+static uint32_t signal_mask = 0;
+/* Whether a conversion is in flight (and we're holding a sleep block for it) */
+static bool converting = false;
+/* Whether the reading in progress covers every probe (a scan) or just the first */
+static bool scanning = false;
+
+/* Whether the CRYOTIMER is running the show (and we're holding an EM3 sleep block for it) */
+static bool autonomous = false;
+/* The sample mode to go back to once autonomous sampling stops */
+static soil_sample_modes manual_mode = SOIL_DEFAULT_SAMPLE_MODE;
+
+/* ADC configuration, computed once and reused until the settings change */
+static soil_adc_power_modes adc_power_mode = SOIL_DEFAULT_ADC_POWER_MODE;
+static ADC_Init_TypeDef adc_settings;
+static ADC_InitSingle_TypeDef adc_settings_single;
+static ADC_InitScan_TypeDef adc_settings_scan;
+static ADC_InitSingle_TypeDef adc_settings_supply;
+static ADC_InitSingle_TypeDef adc_settings_settle;
+static bool config_valid = false;
+/* Whether the ADC is still configured from the last reading */
+static bool adc_ready = false;
+/* Whether the ADC is clocked at all (it can't be touched otherwise) */
+static bool adc_clocked = false;
+/* Which sleep block we took for the conversion in flight */
+static SLEEP_EnergyMode_t held_block = sleepEM2;
+
+/* Cycle counter bookends for the reading in flight */
+static uint32_t start_cycles = 0;
+static volatile uint32_t end_cycles = 0;
+
+/* Probe settling, in soft timer ticks */
+static uint32_t settle_ticks = GET_SOFT_TIMER_COUNTS(SOIL_POWER_ON_TIME);
+/* Whether the reading in progress is learning the settle time, and how it's going */
+static bool learning = false;
+static uint32_t learned_time = 0;
+/* Whether the conversion in flight is a settling step rather than the reading itself */
+static bool stepping = false;
+static uint32_t power_on_time;
+static uint32_t step_start_time;
+static uint32_t last_step_time;
+static uint32_t settled_time;
+static uint16_t last_step_mean;
+static bool have_last_step;
+static uint8_t stable_steps;
+
+/* How the probe is read, and the supply measured alongside it (0 if it wasn't). Shared with the ADC ISR. */
+static soil_measure_modes measure_mode = SOIL_DEFAULT_MEASURE_MODE;
+static volatile uint16_t supply_mv = 0;
+/* Whether the conversion in flight is AVDD, ahead of the probe conversion the ISR chains on to it */
+static volatile bool measuring_supply = false;
+
+/* Current noise reduction settings */
+static soil_sample_modes sample_mode = SOIL_DEFAULT_SAMPLE_MODE;
+static uint16_t sample_count = SOIL_DEFAULT_SAMPLE_COUNT;
+/* log2 of the hardware oversampling rate. Only meaningful in soil_sample_hw_oversample. */
+static uint8_t ovs_shift = 0;
+
+/* Running statistics for the reading in progress. Shared with the ADC ISR. */
+static volatile uint32_t acc_sum;
+static volatile uint16_t acc_min;
+static volatile uint16_t acc_max;
+static volatile uint16_t acc_count;
+static volatile uint64_t acc_sum_squares;
+
+/* Results of the last scan, by probe. scan_ids maps the ADC's scan input IDs back to probes. */
+static uint32_t scan_ids[SOIL_PROBE_COUNT];
+static volatile uint16_t scan_results[SOIL_PROBE_COUNT];
+
+/* Landing zone for DMA bursts. Sorted in place once the burst is collected. */
+static uint16_t dma_buffer[SOIL_DMA_MAX_SAMPLES];
+
+#define _SOIL_DMA_CH_MASK (1 << SOIL_DMA_CHANNEL)
+
+/*
+ * @brief Prepares the soil driver for operation. Should be called before calling any other soil routine.
+ *
+ * @param event_signal_mask The event mask to use with the bluetooth stack when a conversion finishes.
+ *
+ * @return void
+ */
 void soil_init(const uint32_t event_signal_mask) {
+	uint8_t i;
+
+	/* Remember who to tell when the ADC finishes */
+	signal_mask = event_signal_mask;
+
 	/* Connect the GPIO peripheral to the HS Clock Bus */
 	CMU_ClockEnable(cmuClock_GPIO, true);
-	/* Configure the power pin and port to be a strong output */
-	GPIO_DriveStrengthSet(SOIL_PWR_PORT, gpioDriveStrengthStrongAlternateStrong);
+	/* Configure the power pins and ports to be strong outputs */
+	for (i = 0; i < SOIL_PROBE_COUNT; ++i) {
+		GPIO_DriveStrengthSet(probes[i].pwr_port, gpioDriveStrengthStrongAlternateStrong);
+	}
+
+	/* Apply the build time sampling defaults */
+	soil_set_sampling(SOIL_DEFAULT_SAMPLE_MODE, SOIL_DEFAULT_SAMPLE_COUNT);
+	soil_set_adc_power_mode(SOIL_DEFAULT_ADC_POWER_MODE);
+	soil_set_measure_mode(SOIL_DEFAULT_MEASURE_MODE);
+
+	/* Turn on the core cycle counter so we can tell how expensive readings are */
+	enable_cycle_counter();
 
+	/* Bring the DMA controller up in its reset state; the channel is configured per burst. */
+	CMU_ClockEnable(cmuClock_LDMA, true);
+	LDMA->CTRL = 0;
+	LDMA->IEN |= _SOIL_DMA_CH_MASK;
+
+	/* Make sure nothing stale is waiting for us, then let the ADC and DMA talk to the CPU. */
+	NVIC_ClearPendingIRQ(ADC0_IRQn);
+	NVIC_EnableIRQ(ADC0_IRQn);
+	NVIC_ClearPendingIRQ(LDMA_IRQn);
+	NVIC_EnableIRQ(LDMA_IRQn);
 }
 
 /*
- * @brief Starts and configures the ADC and associated GPIO pins.
+ * @brief Changes how many conversions go into each reading and how they are combined.
+ *
+ * Takes effect on the next reading. Does nothing if a conversion is in flight.
+ *
+ * @param mode How the samples should be taken.
+ * @param count The number of conversions per reading. Ignored for soil_sample_single.
  *
  * @return void
  */
-void _ready() {
+void soil_set_sampling(soil_sample_modes mode, uint16_t count) {
+	/* Don't pull the rug out from under the ISR */
+	if (converting || autonomous) {
+		return;
+	}
+
+	/* Keep the count sane */
+	if (count < 1 || mode == soil_sample_single) {
+		count = 1;
+	}
+	if (count > SOIL_MAX_SAMPLE_COUNT) {
+		count = SOIL_MAX_SAMPLE_COUNT;
+	}
+	/* DMA bursts have to fit the buffer, and are pointless when tiny */
+	if (mode == soil_sample_dma) {
+		if (count < SOIL_DMA_MIN_SAMPLES) {
+			count = SOIL_DMA_MIN_SAMPLES;
+		}
+		if (count > SOIL_DMA_MAX_SAMPLES) {
+			count = SOIL_DMA_MAX_SAMPLES;
+		}
+	}
+
+	ovs_shift = 0;
+	if (mode == soil_sample_hw_oversample) {
+		/* The hardware only does powers of two from 2x up, so round down */
+		while ((2u << ovs_shift) <= count) {
+			++ovs_shift;
+		}
+		/* And a 1x "oversample" is just a single conversion */
+		if (ovs_shift == 0) {
+			mode = soil_sample_single;
+		}
+		count = 1 << ovs_shift;
+	}
+
+	sample_mode = mode;
+	sample_count = count;
+
+	/* The ADC setup depends on the sample mode, so start fresh next reading */
+	_shutdown_adc();
+	config_valid = false;
+}
+
+/*
+ * @brief Gets how many conversions go into each reading, after soil_set_sampling has clamped and rounded it.
+ *
+ * @return The number of conversions per reading.
+ */
+uint16_t soil_get_sample_count() {
+	return sample_count;
+}
+
+/*
+ * @brief Gets how readings are taken, after soil_set_sampling has settled on a mode.
+ *
+ * @return The sample mode. While autonomous sampling runs, the one that comes back when it stops.
+ */
+soil_sample_modes soil_get_sample_mode() {
+	return autonomous ? manual_mode : sample_mode;
+}
+
+/*
+ * @brief Changes whether the ADC is kept configured (and how warm) between readings.
+ *
+ * Takes effect on the next reading. Does nothing if a conversion is in flight.
+ *
+ * @param mode How the ADC should be kept between readings.
+ *
+ * @return void
+ */
+void soil_set_adc_power_mode(soil_adc_power_modes mode) {
+	/* Don't pull the rug out from under the ISR */
+	if (converting || autonomous) {
+		return;
+	}
+
+	adc_power_mode = mode;
+
+	/* The clocking and warm up mode change, so start fresh next reading */
+	_shutdown_adc();
+	config_valid = false;
+}
+
+/*
+ * @brief Changes whether the probe is read single ended or differentially (and scaled to the supply).
+ *
+ * Takes effect on the next reading. Does nothing if a conversion is in flight.
+ *
+ * @param mode How the probe should be read.
+ *
+ * @return void
+ */
+void soil_set_measure_mode(soil_measure_modes mode) {
+	/* Don't pull the rug out from under the ISR */
+	if (converting || autonomous) {
+		return;
+	}
+
+	measure_mode = mode;
+
+	/* The inputs and reference change, so start fresh next reading */
+	_shutdown_adc();
+	config_valid = false;
+}
+
+/*
+ * @brief Works out the ADC settings for the current modes. The result is cached until the modes change.
+ *
+ * @return void
+ */
+static void _build_config() {
 	ADC_Init_TypeDef _init_settings = ADC_INIT_DEFAULT;
 	ADC_InitSingle_TypeDef _init_settings_single = ADC_INITSINGLE_DEFAULT;
-	/* Connect the ADC0 peripheral to the HS Clock Bus */
-	CMU_ClockEnable(cmuClock_ADC0, true);
+	ADC_InitScan_TypeDef _init_settings_scan = ADC_INITSCAN_DEFAULT;
+	ADC_InitSingle_TypeDef _init_settings_supply = ADC_INITSINGLE_DEFAULT;
+	ADC_InitSingle_TypeDef _init_settings_settle;
+	bool differential = (measure_mode == soil_measure_differential);
+	uint32_t adc_source_freq = 0; /* 0 tells emlib to use the current HFPERCLK */
+	uint8_t i;
+
+	if (adc_power_mode == soil_adc_cold) {
+		/* Off between readings, so don't spend anything keeping it warm */
+		_init_settings.warmUpMode = adcWarmupNormal;
+	} else {
+		/* Clock on demand from AUXHFRCO so we don't hold the HF clocks up (and can stay in EM2) */
+		_init_settings.em2ClockConfig = adcEm2ClockOnDemand;
+		adc_source_freq = CMU_ClockFreqGet(cmuClock_AUX);
+		_init_settings.warmUpMode = (adc_power_mode == soil_adc_keep_warm) ? adcWarmupKeepADCWarm : adcWarmupKeepInStandby;
+	}
 
-	/* Setup the timebases and initialize the ADC */
-	_init_settings.timebase = ADC_TimebaseCalc(0);
-	_init_settings.prescale = ADC_PrescaleCalc(400000, 0);
-	_init_settings.warmUpMode =
+	/* Setup the timebases */
+	_init_settings.timebase = ADC_TimebaseCalc(adc_source_freq);
+	_init_settings.prescale = ADC_PrescaleCalc(SOIL_ADC_FREQ, adc_source_freq);
 
-	/* Setup for a single ended, long duration measurement */
+	/* Setup for a long duration measurement, across the probe against a fixed reference if differential */
 	_init_settings_single.acqTime = adcAcqTime256;
-	_init_settings_single.diff = false;
-	_init_settings_single.posSel = SOIL_SIGNAL_POS_MUX;
-	_init_settings_single.negSel = SOIL_SIGNAL_NEG_MUX;
-	_init_settings_single.reference = SOIL_SIGNAL_REF;
+	_init_settings_single.diff = differential;
+	_init_settings_single.posSel = probes[0].pos_sel;
+	_init_settings_single.negSel = probes[0].neg_sel;
+	_init_settings_single.reference = differential ? SOIL_DIFF_REF : SOIL_SIGNAL_REF;
+
+	/* Scans take every probe the same way, one after the other */
+	_init_settings_scan.acqTime = adcAcqTime256;
+	_init_settings_scan.reference = differential ? SOIL_DIFF_REF : SOIL_SIGNAL_REF;
+	ADC_ScanInputClear(&_init_settings_scan);
+	for (i = 0; i < SOIL_PROBE_COUNT; ++i) {
+		scan_ids[i] = ADC_ScanSingleEndedInputAdd(&_init_settings_scan, probes[i].scan_group, probes[i].pos_sel);
+	}
+
+	/* AVDD is stiff, so a short acquisition will do. It never oversamples. */
+	_init_settings_supply.acqTime = adcAcqTime16;
+	_init_settings_supply.posSel = adcPosSelAVDD;
+	_init_settings_supply.negSel = adcNegSelVSS;
+	_init_settings_supply.reference = SOIL_SUPPLY_REF;
+
+	/* Settling steps read the first probe as the reading would, but once, so they're over quickly */
+	_init_settings_settle = _init_settings_single;
+
+	/* If the ADC is doing the averaging for us, turn that on. */
+	if (sample_mode == soil_sample_hw_oversample) {
+		/* adcOvsRateSel2 is 0, so the rate select is one less than our shift */
+		_init_settings.ovsRateSel = (ADC_OvsRateSel_TypeDef) (ovs_shift - 1);
+		_init_settings_single.resolution = adcResOVS;
+		_init_settings_scan.resolution = adcResOVS;
+	}
+
+	/* For DMA, let the ADC free run; the DMA request paces the transfer and we stop it at the end. */
+	if (sample_mode == soil_sample_dma) {
+		_init_settings_single.rep = true;
+	}
+
+	adc_settings = _init_settings;
+	adc_settings_single = _init_settings_single;
+	adc_settings_scan = _init_settings_scan;
+	adc_settings_supply = _init_settings_supply;
+	adc_settings_settle = _init_settings_settle;
+	config_valid = true;
+}
+
+/*
+ * @brief Starts and configures the ADC and associated GPIO pins.
+ *
+ * @return void
+ */
+void _ready() {
+	/* If we kept it configured from last time, there's nothing to do. */
+	if (adc_ready) {
+		return;
+	}
+
+	/* Only do the math when something changed */
+	if (!config_valid) {
+		_build_config();
+	}
+
+	/* The persistent modes run from AUXHFRCO, which the ADC turns on when it needs it. */
+	if (adc_power_mode != soil_adc_cold) {
+		CMU_ClockSelectSet(cmuClock_ADC0ASYNC, cmuSelect_AUXHFRCO);
+		CMU_OscillatorEnable(cmuOsc_AUXHFRCO, false, false);
+	}
+
+	/* Connect the ADC0 peripheral to the HS Clock Bus */
+	CMU_ClockEnable(cmuClock_ADC0, true);
+	adc_clocked = true;
 
 	/* Ask EM lib to set things up for us. */
-	ADC_Init(ADC0, &_init_settings);
-	ADC_InitSingle(ADC0, &_init_settings_single);
+	ADC_Init(ADC0, &adc_settings);
+	ADC_InitSingle(ADC0, &adc_settings_single);
+	ADC_InitScan(ADC0, &adc_settings_scan);
+
+	/* In the persistent modes, leave it that way for next time */
+	adc_ready = (adc_power_mode != soil_adc_cold);
 
 	return;
 }
 
 /*
- * @brief Starts up the sensor
+ * @brief Starts up the sensor, or every sensor if we're scanning
  *
  * @return void
  */
 static void _power_on_sensor() {
-	/* Turn on the power management pin */
-	GPIO_PinModeSet(SOIL_PWR_PORT,SOIL_PWR_PIN, gpioModePushPull, true);
+	uint8_t i;
+
+	/* Turn on the power management pins together so they settle together */
+	for (i = 0; i < (scanning ? SOIL_PROBE_COUNT : 1); ++i) {
+		GPIO_PinModeSet(probes[i].pwr_port, probes[i].pwr_pin, gpioModePushPull, true);
+	}
 }
 
 /*
- * @brief Shuts down the sensor
+ * @brief Shuts down the sensor, or every sensor if we're scanning
  *
  * @return void
  */
 static void _power_off_sensor() {
-	/* Turn off the power management pin */
-	GPIO_PinModeSet(SOIL_PWR_PORT,SOIL_PWR_PIN, gpioModeDisabled, false);
+	uint8_t i;
+
+	/* Turn off the power management pins */
+	for (i = 0; i < (scanning ? SOIL_PROBE_COUNT : 1); ++i) {
+		GPIO_PinModeSet(probes[i].pwr_port, probes[i].pwr_pin, gpioModeDisabled, false);
+	}
 }
 
 /*
- * @brief Shuts down the ADC
+ * @brief Finishes with the ADC after a reading. Only shuts it down in cold mode.
  *
  * @return void
  */
 void _unready() {
+	/* The persistent modes keep their configuration (and warm up state) */
+	if (adc_power_mode != soil_adc_cold) {
+		return;
+	}
+
+	_shutdown_adc();
+}
+
+/*
+ * @brief Shuts down the ADC regardless of mode
+ *
+ * @return void
+ */
+static void _shutdown_adc() {
+	/* Nothing to do if it's already off */
+	if (!adc_clocked) {
+		return;
+	}
+
 	/* Reset/disable the ADC */
 	ADC_Reset(ADC0);
 	/* And unclock it */
 	CMU_ClockEnable(cmuClock_ADC0, false);
+	adc_clocked = false;
+	adc_ready = false;
+}
+
+/*
+ * @brief Clears out the running statistics ahead of a new reading.
+ *
+ * @return void
+ */
+static void _begin_accumulating() {
+	acc_sum = 0;
+	acc_sum_squares = 0;
+	acc_min = UINT16_MAX;
+	acc_max = 0;
+	acc_count = 0;
+}
+
+/*
+ * @brief Folds one conversion result into the running statistics.
+ *
+ * Safe to call from the ADC ISR.
+ *
+ * @param sample The raw ADC data register value.
+ *
+ * @return True if more conversions are needed to finish the reading.
+ */
+static bool _accumulate(uint16_t sample) {
+	/* Autonomous sampling is always single ended */
+	sample = _to_12_bits(sample, measure_mode == soil_measure_differential && !autonomous);
+
+	acc_sum += sample;
+	acc_sum_squares += (uint32_t) sample * sample;
+	if (sample < acc_min) {
+		acc_min = sample;
+	}
+	if (sample > acc_max) {
+		acc_max = sample;
+	}
+	++acc_count;
+
+	/* Only burst mode needs the CPU to kick off more conversions, and settling steps are always one */
+	return (sample_mode == soil_sample_burst) && !stepping && (acc_count < sample_count);
+}
+
+/*
+ * @brief Brings a raw result back to 12 bits. Hardware oversampled results come back wider.
+ *
+ * Differential results are two's complement over +/- the reference. They're doubled onto the
+ * same 0 to full scale counts as single ended results, with a reversed probe reading as 0.
+ *
+ * Safe to call from the ADC ISR.
+ *
+ * @param sample The raw ADC data register value (or its low half, as the DMA moves it).
+ * @param signed_result Whether the sample came from a differential conversion.
+ *
+ * @return The result in 12 bit counts.
+ */
+static uint16_t _to_12_bits(uint32_t sample, bool signed_result) {
+	int32_t value;
+
+	if (!signed_result) {
+		if (sample_mode == soil_sample_hw_oversample && !stepping) {
+			sample >>= (ovs_shift < 4 ? ovs_shift : 4);
+		}
+		return (uint16_t) sample;
+	}
+
+	/* Every differential result fits in 16 bits, so this sign extends whichever way it arrived */
+	value = (int16_t) sample;
+	if (sample_mode == soil_sample_hw_oversample && !stepping) {
+		value >>= (ovs_shift < 4 ? ovs_shift : 4);
+	}
+	if (value < 0) {
+		return 0;
+	}
+	value <<= 1;
+	if (value > ((1 << SOIL_RESULT_BITS) - 1)) {
+		value = (1 << SOIL_RESULT_BITS) - 1;
+	}
+	return (uint16_t) value;
+}
+
+/*
+ * @brief Turns the running statistics into a reading.
+ *
+ * @param reading Where to put the result.
+ *
+ * @return void
+ */
+static void _collect(soil_reading *reading) {
+	uint64_t mean_squared;
+
+	/* Unsigned math handles the counter wrapping */
+	reading->cycles = end_cycles - start_cycles;
+
+	/* DMA bursts keep their data in the buffer instead */
+	if (sample_mode == soil_sample_dma) {
+		_collect_dma(reading);
+		_normalize(reading);
+		return;
+	}
+
+	/* Guard against reading before anything was converted */
+	if (acc_count == 0) {
+		reading->mean = 0;
+		reading->min = 0;
+		reading->max = 0;
+		reading->median = 0;
+		reading->variance = 0;
+		reading->count = 0;
+		reading->supply_mv = supply_mv;
+		return;
+	}
+
+	/* Round to nearest */
+	reading->mean = (uint16_t) ((acc_sum + (acc_count >> 1)) / acc_count);
+	reading->min = acc_min;
+	reading->max = acc_max;
+	/* Without the raw samples, the best guess at the middle is the mean */
+	reading->median = reading->mean;
+	/* Var = E[x^2] - E[x]^2, kept in integer counts squared */
+	mean_squared = ((uint64_t) acc_sum * acc_sum) / acc_count;
+	reading->variance = (uint32_t) ((acc_sum_squares - mean_squared) / acc_count);
+	/* A hardware oversampled reading counts every conversion the ADC averaged */
+	reading->count = (sample_mode == soil_sample_hw_oversample) ? sample_count : acc_count;
+
+	_normalize(reading);
+}
+
+/*
+ * @brief Converts AVDD while the ADC is already up for a reading, then puts the probe setup back.
+ *
+ * Only done in differential mode; otherwise the reference is VDD and there's nothing to divide out.
+ * Polls, so it's only for soil_get_reading_sync; asynchronous readings have the ADC ISR chain the
+ * probe conversion on to the supply one instead. The ADC must be readied and idle.
+ *
+ * @return void
+ */
+static void _measure_supply() {
+	if (measure_mode != soil_measure_differential || autonomous) {
+		supply_mv = 0;
+		return;
+	}
+
+	ADC_InitSingle(ADC0, &adc_settings_supply);
+	ADC_Start(ADC0, adcStartSingle);
+	while ( (ADC0->STATUS & ADC_STATUS_SINGLEDV) == 0 ) {
+	}
+	supply_mv = (uint16_t) ((ADC_DataSingleGet(ADC0) * SOIL_FIXED_REF_MV) >> SOIL_RESULT_BITS);
+
+	/* Back to the probe for the real reading */
+	ADC_InitSingle(ADC0, &adc_settings_single);
+}
+
+/*
+ * @brief Scales a reading taken against the fixed reference to a fraction of the measured supply.
+ *
+ * Leaves readings alone if no supply was measured for them.
+ *
+ * @param reading The reading to scale in place.
+ *
+ * @return void
+ */
+static void _normalize(soil_reading *reading) {
+	uint64_t variance;
+
+	reading->supply_mv = supply_mv;
+	if (supply_mv == 0) {
+		return;
+	}
+
+	reading->mean = _scale_to_supply(reading->mean);
+	reading->min = _scale_to_supply(reading->min);
+	reading->max = _scale_to_supply(reading->max);
+	reading->median = _scale_to_supply(reading->median);
+	/* Variance scales with the square */
+	variance = ((uint64_t) reading->variance * SOIL_FIXED_REF_MV * SOIL_FIXED_REF_MV) / ((uint32_t) supply_mv * supply_mv);
+	reading->variance = (variance > UINT32_MAX) ? UINT32_MAX : (uint32_t) variance;
+}
+
+/*
+ * @brief Rescales counts of the fixed reference to counts of the measured supply.
+ *
+ * @param counts The 12 bit result against SOIL_FIXED_REF_MV.
+ *
+ * @return The 12 bit result against supply_mv, saturated at full scale.
+ */
+static uint16_t _scale_to_supply(uint16_t counts) {
+	uint32_t scaled = ((uint32_t) counts * SOIL_FIXED_REF_MV + (supply_mv >> 1)) / supply_mv;
+
+	if (scaled > ((1 << SOIL_RESULT_BITS) - 1)) {
+		scaled = (1 << SOIL_RESULT_BITS) - 1;
+	}
+	return (uint16_t) scaled;
+}
+
+/*
+ * @brief Points the DMA channel at the ADC and arms it for one burst into dma_buffer.
+ *
+ * The ADC must already be readied (in repeat mode) but not started.
+ *
+ * @return void
+ */
+static void _start_dma() {
+	LDMA_CH_TypeDef *ch = &LDMA->CH[SOIL_DMA_CHANNEL];
+
+	/* Make sure the channel is idle and its old done flag is gone */
+	LDMA->CHEN &= ~_SOIL_DMA_CH_MASK;
+	LDMA->CHDONE &= ~_SOIL_DMA_CH_MASK;
+	LDMA->IFC = _SOIL_DMA_CH_MASK;
+
+	/* Pull from the ADC single result whenever it's valid */
+	ch->REQSEL = LDMA_CH_REQSEL_SOURCESEL_ADC0 | LDMA_CH_REQSEL_SIGSEL_ADC0SINGLE;
+	ch->CFG = 0;
+	ch->LOOP = 0;
+	ch->SRC = (uint32_t) &ADC0->SINGLEDATA;
+	ch->DST = (uint32_t) dma_buffer;
+	ch->LINK = 0;
+	/* One halfword per request, sample_count of them, then raise DONE */
+	ch->CTRL = LDMA_CH_CTRL_STRUCTTYPE_TRANSFER
+			| (((uint32_t) (sample_count - 1) << _LDMA_CH_CTRL_XFERCNT_SHIFT) & _LDMA_CH_CTRL_XFERCNT_MASK)
+			| LDMA_CH_CTRL_BLOCKSIZE_UNIT1
+			| LDMA_CH_CTRL_DONEIFSEN
+			| LDMA_CH_CTRL_REQMODE_BLOCK
+			| LDMA_CH_CTRL_SRCINC_NONE
+			| LDMA_CH_CTRL_SIZE_HALFWORD
+			| LDMA_CH_CTRL_DSTINC_ONE;
+
+	/* Arm it; nothing moves until the ADC starts producing */
+	LDMA->CHEN |= _SOIL_DMA_CH_MASK;
+}
+
+/*
+ * @brief Halts the free running ADC and disarms the DMA channel.
+ *
+ * @return void
+ */
+static void _stop_dma() {
+	ADC0->CMD = ADC_CMD_SINGLESTOP;
+	LDMA->CHEN &= ~_SOIL_DMA_CH_MASK;
+}
+
+/*
+ * @brief Computes the burst statistics over dma_buffer in fixed point.
+ *
+ * Sorts the buffer in place to find the median, so the raw order is lost afterwards.
+ *
+ * @param reading Where to put the result.
+ *
+ * @return void
+ */
+static void _collect_dma(soil_reading *reading) {
+	uint32_t sum = 0;
+	uint32_t sum_squared_error = 0;
+	uint16_t mean;
+	uint16_t i;
+	uint16_t j;
+	uint16_t sample;
+	int32_t error;
+
+	/* The DMA moved raw results; get them into counts first */
+	if (measure_mode == soil_measure_differential) {
+		for (i = 0; i < sample_count; ++i) {
+			dma_buffer[i] = _to_12_bits(dma_buffer[i], true);
+		}
+	}
+
+	/* Two passes keep everything in 32 bits: 256 * 4095^2 still fits */
+	for (i = 0; i < sample_count; ++i) {
+		sum += dma_buffer[i];
+	}
+	mean = (uint16_t) ((sum + (sample_count >> 1)) / sample_count);
+	for (i = 0; i < sample_count; ++i) {
+		error = (int32_t) dma_buffer[i] - mean;
+		sum_squared_error += (uint32_t) (error * error);
+	}
+
+	/* Insertion sort; the buffer is small and usually nearly sorted already (the signal is flat) */
+	for (i = 1; i < sample_count; ++i) {
+		sample = dma_buffer[i];
+		for (j = i; j > 0 && dma_buffer[j - 1] > sample; --j) {
+			dma_buffer[j] = dma_buffer[j - 1];
+		}
+		dma_buffer[j] = sample;
+	}
+
+	reading->mean = mean;
+	reading->min = dma_buffer[0];
+	reading->max = dma_buffer[sample_count - 1];
+	/* An odd burst has a middle sample; an even one averages the middle pair */
+	if (sample_count & 1) {
+		reading->median = dma_buffer[sample_count >> 1];
+	} else {
+		reading->median = (dma_buffer[(sample_count >> 1) - 1] + dma_buffer[sample_count >> 1] + 1) >> 1;
+	}
+	reading->variance = sum_squared_error / sample_count;
+	reading->count = sample_count;
 }
 
 /*
@@ -108,23 +766,46 @@ void _unready() {
  *
  * Does not require the BGAPI to function but does not provide power on delays.
  *
- * @return The ADC result of the soil reading
+ * @param reading Where to put the soil reading.
+ *
+ * @return void
  */
-uint16_t soil_get_reading_sync() {
-	uint16_t result;
+void soil_get_reading_sync(soil_reading *reading) {
+	/* Only the first probe */
+	scanning = false;
 
 	/* Turn on the sensor */
 	_power_on_sensor();
+
 	/* and ready the ADC */
+	start_cycles = DWT->CYCCNT;
 	_ready();
+	_measure_supply();
 
-	/* Start the measurement */
-	ADC_Start(ADC0, adcStartSingle);
-	/* Stall for the measurement to finish */
-	while ( (ADC0->STATUS & ADC_STATUS_SINGLEDV) == 0 ) {
+	_begin_accumulating();
+
+	if (sample_mode == soil_sample_dma) {
+		/* DMA mode just needs to be armed and waited on. Keep the ISR from signaling the BGAPI. */
+		LDMA->IEN &= ~_SOIL_DMA_CH_MASK;
+		_start_dma();
+		ADC_Start(ADC0, adcStartSingle);
+		/* Stall for the burst to land */
+		while ( (LDMA->CHDONE & _SOIL_DMA_CH_MASK) == 0 ) {
+		}
+		_stop_dma();
+		LDMA->IFC = _SOIL_DMA_CH_MASK;
+		LDMA->IEN |= _SOIL_DMA_CH_MASK;
+	} else {
+		do {
+			/* Start the measurement */
+			ADC_Start(ADC0, adcStartSingle);
+			/* Stall for the measurement to finish */
+			while ( (ADC0->STATUS & ADC_STATUS_SINGLEDV) == 0 ) {
+			}
+		/* Cache the result, and go again if we need more */
+		} while (_accumulate(ADC_DataSingleGet(ADC0)));
 	}
-	/* Cache the result */
-	result = ADC_DataSingleGet(ADC0);
+	end_cycles = DWT->CYCCNT;
 
 	/* And shut down the ADC */
 	_unready();
@@ -132,52 +813,683 @@ uint16_t soil_get_reading_sync() {
 	_power_off_sensor();
 
 	/* And return the result. */
-	return result;
+	_collect(reading);
 }
 
 /*
  * @brief Starts the power on process for the ADC
  *
- * Requires the BGAPI be initialized and that a handler for the external signal be in place.
+ * Requires the BGAPI be initialized and that a handler for SOIL_POWER_ON_HANDLE be in place.
+ * That handler should call soil_start_conversion_async.
  *
- * @return The ADC result of the soil reading
+ * @return void
  */
 void soil_start_reading_async() {
+	scanning = false;
+	_start_power_on();
+}
+
+/*
+ * @brief Starts the power on process for a scan of every probe.
+ *
+ * All of the probes are powered together and share one settle delay, then they're converted
+ * back to back in a single ADC scan sequence. Hardware oversampling applies to each probe; the
+ * burst and DMA modes don't, and a scan takes one (possibly oversampled) conversion per probe.
+ * Like soil_start_reading_async, the SOIL_POWER_ON_HANDLE handler should call
+ * soil_start_conversion_async, and the result is picked up with soil_finish_scan_async.
+ *
+ * @return void
+ */
+void soil_start_scan_async() {
+	/* Don't change what's being read out from under a conversion, or the CRYOTIMER */
+	if (converting || autonomous) {
+		return;
+	}
+
+	scanning = true;
+	_start_power_on();
+}
+
+/*
+ * @brief Powers the probe(s) for the reading about to happen and starts the settle delay.
+ *
+ * @return void
+ */
+static void _start_power_on() {
+	uint32_t now = _now();
+
+	/* Every so often, check that the probe still settles like we think it does */
+	if ((now - learned_time) >= GET_SOFT_TIMER_COUNTS(SOIL_SETTLE_RELEARN_INTERVAL)) {
+		learning = true;
+	}
+
 	/* Turn on the sensor */
 	_power_on_sensor();
+
+	if (learning) {
+		/* Watch it settle instead of trusting the last number */
+		learned_time = now;
+		power_on_time = now;
+		have_last_step = false;
+		stable_steps = 0;
+		DEBUG_ASSERT_BGAPI_SUCCESS(
+				gecko_cmd_hardware_set_soft_timer(GET_SOFT_TIMER_COUNTS(SOIL_SETTLE_STEP_TIME), SOIL_POWER_ON_HANDLE, SOFT_TIMER_ONE_SHOT)->result,
+				"Failed to start sensor settle timer.");
+		return;
+	}
+
 	/* And start the delay */
 	DEBUG_ASSERT_BGAPI_SUCCESS(
-			gecko_cmd_hardware_set_soft_timer(GET_SOFT_TIMER_COUNTS(SOIL_POWER_ON_TIME), SOIL_POWER_ON_HANDLE, SOFT_TIMER_ONE_SHOT)->result,
+			gecko_cmd_hardware_set_soft_timer(settle_ticks, SOIL_POWER_ON_HANDLE, SOFT_TIMER_ONE_SHOT)->result,
 			"Failed to start sensor power on timer.");
 }
 
 /*
- * @brief Finishes the power on and makes the measurement.
+ * @brief Learns the probe settle time over the next reading instead of using the current one.
+ *
+ * @return void
+ */
+void soil_start_learning() {
+	learning = true;
+}
+
+/*
+ * @brief Sets how long the probe is powered before converting. Use this to restore a learned value.
  *
- * Should be called from the BGAPI external signal handler.
+ * @param ticks The settle time in soft timer ticks. 0 restores the default.
  *
- * @return The ADC result of the soil reading
+ * @return void
+ */
+void soil_set_settle_time(uint32_t ticks) {
+	if (ticks == 0) {
+		ticks = GET_SOFT_TIMER_COUNTS(SOIL_POWER_ON_TIME);
+	}
+	if (ticks > GET_SOFT_TIMER_COUNTS(SOIL_SETTLE_MAX_TIME)) {
+		ticks = GET_SOFT_TIMER_COUNTS(SOIL_SETTLE_MAX_TIME);
+	}
+	settle_ticks = ticks;
+}
+
+/*
+ * @brief Gets how long the probe is currently powered before converting.
+ *
+ * @return The settle time in soft timer ticks.
+ */
+uint32_t soil_get_settle_time() {
+	return settle_ticks;
+}
+
+/*
+ * @brief Gets the stack's idea of the current time.
+ *
+ * @return The time in soft timer ticks. Wraps about every 36 hours, which unsigned math handles.
+ */
+static uint32_t _now() {
+	struct gecko_msg_hardware_get_time_rsp_t *time = gecko_cmd_hardware_get_time();
+	return (time->seconds * (uint32_t) SOFT_TIMER_FREQUENCY) + time->ticks;
+}
+
+/*
+ * @brief Folds one settling conversion into the learning state.
+ *
+ * @param mean The conversion that just finished, in 12 bit counts.
+ *
+ * @return True once the probe has settled (or we've given up waiting).
  */
-uint16_t soil_finish_reading_async() {
-	uint16_t result;
+static bool _settle_step(uint16_t mean) {
+	uint32_t now = _now();
+	uint32_t learned;
+	uint16_t difference;
 
+	difference = (mean > last_step_mean) ? (mean - last_step_mean) : (last_step_mean - mean);
+
+	/* Compare with the previous step, if there was one. */
+	if (have_last_step && difference <= SOIL_SETTLE_TOLERANCE) {
+		/* The previous step was already where we ended up; that's when it settled. Its conversion
+		 * started at last_step_time, so how long it took to convert isn't counted. */
+		if (stable_steps == 0) {
+			settled_time = last_step_time - power_on_time;
+		}
+		++stable_steps;
+	} else {
+		stable_steps = 0;
+	}
+
+	last_step_mean = mean;
+	last_step_time = step_start_time;
+	have_last_step = true;
+
+	/* Keep going until it's agreed enough times, or it's taking too long */
+	if (stable_steps < SOIL_SETTLE_CONFIRMATIONS && (now - power_on_time) < GET_SOFT_TIMER_COUNTS(SOIL_SETTLE_MAX_TIME)) {
+		return false;
+	}
+
+	if (stable_steps < SOIL_SETTLE_CONFIRMATIONS) {
+		/* Never settled; be as patient as we're allowed to be */
+		learned = GET_SOFT_TIMER_COUNTS(SOIL_SETTLE_MAX_TIME);
+	} else {
+		learned = settled_time + (settled_time * SOIL_SETTLE_MARGIN_PERCENT) / 100;
+		if (learned < GET_SOFT_TIMER_COUNTS(SOIL_SETTLE_MIN_TIME)) {
+			learned = GET_SOFT_TIMER_COUNTS(SOIL_SETTLE_MIN_TIME);
+		}
+	}
+
+	soil_set_settle_time(learned);
+	learning = false;
+	debug_log("Probe settle time learned: %lu ticks", settle_ticks);
+	return true;
+}
+
+/*
+ * @brief Finishes a settling step, then either schedules the next one or starts the real reading.
+ *
+ * @return False, always; the reading (or scan) is still to come and the caller should wait for the next signal.
+ */
+static bool _finish_settle_step() {
+	uint16_t mean = (acc_count > 0) ? (uint16_t) (acc_sum / acc_count) : 0;
+
+	/* Stop listening to the ADC, and put the reading setup back */
+	ADC_IntDisable(ADC0, ADC_IEN_SINGLE);
+	ADC_InitSingle(ADC0, &adc_settings_single);
+	_unready();
+
+	/* Let the core go back to deep sleep */
+	SLEEP_SleepBlockEnd(held_block);
+	converting = false;
+	stepping = false;
+
+	if (_settle_step(mean)) {
+		/* It's settled, and still powered, so the reading can go right now */
+		soil_start_conversion_async();
+	} else {
+		/* Leave it on and look again shortly */
+		DEBUG_ASSERT_BGAPI_SUCCESS(
+				gecko_cmd_hardware_set_soft_timer(GET_SOFT_TIMER_COUNTS(SOIL_SETTLE_STEP_TIME), SOIL_POWER_ON_HANDLE, SOFT_TIMER_ONE_SHOT)->result,
+				"Failed to start sensor settle timer.");
+	}
+	return false;
+}
+
+/*
+ * @brief Readies the ADC and starts the conversion once the sensor has settled.
+ *
+ * Should be called from the SOIL_POWER_ON_HANDLE soft timer handler. The ADC ISR
+ * raises the external signal given to soil_init when the result is ready. The core
+ * is held out of EM2 (it will idle in EM1) while the conversion is running, since the
+ * ADC is clocked from HFPERCLK.
+ *
+ * @return void
+ */
+void soil_start_conversion_async() {
+	/* If we're already converting, don't stack another sleep block on top. */
+	if (converting || autonomous) {
+		return;
+	}
+	converting = true;
+	start_cycles = DWT->CYCCNT;
+
+	/*
+	 * Cold mode clocks the ADC (and DMA always needs) HFPERCLK, so keep that running.
+	 * Otherwise the ADC has its own clock, and it's fine to go down to EM2 while it works.
+	 */
+	held_block = (adc_power_mode == soil_adc_cold || (sample_mode == soil_sample_dma && !scanning)) ? sleepEM2 : sleepEM3;
+	SLEEP_SleepBlockBegin(held_block);
 
-	/* Ready the ADC */
 	_ready();
 
-	/* Start the measurement */
+	if (learning) {
+		/* One plain conversion of the first probe, timed from when it starts */
+		stepping = true;
+		ADC_InitSingle(ADC0, &adc_settings_settle);
+		_begin_accumulating();
+		ADC_IntClear(ADC0, ADC_IF_SINGLE);
+		ADC_IntEnable(ADC0, ADC_IEN_SINGLE);
+		step_start_time = _now();
+		ADC_Start(ADC0, adcStartSingle);
+		return;
+	}
+
+	if (measure_mode == soil_measure_differential) {
+		/* See what the supply is doing while we're up. The ISR starts the probe once it knows. */
+		measuring_supply = true;
+		ADC_InitSingle(ADC0, &adc_settings_supply);
+		ADC_IntClear(ADC0, ADC_IF_SINGLE);
+		ADC_IntEnable(ADC0, ADC_IEN_SINGLE);
+		ADC_Start(ADC0, adcStartSingle);
+		return;
+	}
+
+	supply_mv = 0;
+	_start_probe_conversion();
+}
+
+/*
+ * @brief Starts converting the probe (or every probe, if we're scanning) for the reading in flight.
+ *
+ * Safe to call from the ADC ISR. The ADC must be readied with the probe setup and idle.
+ *
+ * @return void
+ */
+static void _start_probe_conversion() {
+	if (scanning) {
+		/* Ask the ADC to tell us when it's been through every probe, and go */
+		ADC_IntClear(ADC0, ADC_IF_SCAN);
+		ADC_IntEnable(ADC0, ADC_IEN_SCAN);
+		ADC_Start(ADC0, adcStartScan);
+		return;
+	}
+
+	/* Clear out the last reading */
+	_begin_accumulating();
+
+	if (sample_mode == soil_sample_dma) {
+		/* The DMA will tell us when the whole burst is in */
+		_start_dma();
+	} else {
+		/* Ask the ADC to tell us when it's done */
+		ADC_IntClear(ADC0, ADC_IF_SINGLE);
+		ADC_IntEnable(ADC0, ADC_IEN_SINGLE);
+	}
+
+	/* Start the measurement. We'll hear back in the ISR. */
 	ADC_Start(ADC0, adcStartSingle);
-	/* Stall for the measurement to finish */
-	while ( (ADC0->STATUS & ADC_STATUS_SINGLEDV) == 0 ) {
+}
+
+/*
+ * @brief Finishes the measurement and shuts down the sensor and ADC.
+ *
+ * Should be called from the BGAPI external signal handler once the signal given to soil_init arrives.
+ * While learning the settle time, the probe is left powered and the next settling step is scheduled
+ * instead; the caller should wait for the next signal.
+ *
+ * @param reading Where to put the soil reading.
+ *
+ * @return True if the reading is final. False if the probe is still settling.
+ */
+bool soil_finish_reading_async(soil_reading *reading) {
+	/* If nothing was running (or the hardware is running itself), just hand back what we had last. */
+	if (!converting || autonomous) {
+		_collect(reading);
+		return true;
+	}
+
+	/* A settling step isn't the reading */
+	if (stepping) {
+		return _finish_settle_step();
+	}
+
+	/* Stop listening to the ADC */
+	ADC_IntDisable(ADC0, ADC_IEN_SINGLE);
+	/* And make sure the DMA is done with it too */
+	if (sample_mode == soil_sample_dma) {
+		_stop_dma();
 	}
-	/* Cache the result */
-	result = ADC_DataSingleGet(ADC0);
 
 	/* And shut down the ADC */
 	_unready();
+
+	/* Let the core go back to deep sleep */
+	SLEEP_SleepBlockEnd(held_block);
+	converting = false;
+
+	_collect(reading);
+
 	/* Turn off the sensor */
 	_power_off_sensor();
 
 	/* And return the result. */
-	return result;
+	return true;
+}
+
+/*
+ * @brief Finishes a scan and shuts down the sensors and ADC.
+ *
+ * Should be called from the BGAPI external signal handler once the signal given to soil_init arrives
+ * after soil_start_scan_async. While learning the settle time, the first probe is used to judge
+ * settling and the caller should wait for the next signal when this returns false.
+ *
+ * @param readings Where to put the readings, one per probe in SOIL_PROBES order.
+ *
+ * @return True if the readings are final. False if the probes are still settling.
+ */
+bool soil_finish_scan_async(soil_reading readings[SOIL_PROBE_COUNT]) {
+	/* If nothing was running, just hand back what we had last. */
+	if (!converting || !scanning) {
+		_collect_scan(readings);
+		return true;
+	}
+
+	/* A settling step isn't the scan */
+	if (stepping) {
+		return _finish_settle_step();
+	}
+
+	/* Stop listening to the ADC */
+	ADC_IntDisable(ADC0, ADC_IEN_SCAN);
+
+	/* And shut down the ADC */
+	_unready();
+
+	/* Let the core go back to deep sleep */
+	SLEEP_SleepBlockEnd(held_block);
+	converting = false;
+
+	_collect_scan(readings);
+
+	/* Turn off the sensors */
+	_power_off_sensor();
+
+	return true;
+}
+
+/*
+ * @brief Turns the last scan's results into readings.
+ *
+ * @param readings Where to put the readings, one per probe.
+ *
+ * @return void
+ */
+static void _collect_scan(soil_reading readings[SOIL_PROBE_COUNT]) {
+	uint8_t i;
+
+	for (i = 0; i < SOIL_PROBE_COUNT; ++i) {
+		/* Each probe only got the one (maybe hardware averaged) conversion */
+		readings[i].mean = scan_results[i];
+		readings[i].min = scan_results[i];
+		readings[i].max = scan_results[i];
+		readings[i].median = scan_results[i];
+		readings[i].variance = 0;
+		readings[i].count = (sample_mode == soil_sample_hw_oversample) ? sample_count : 1;
+		/* They all shared the same wake */
+		readings[i].cycles = end_cycles - start_cycles;
+		_normalize(&readings[i]);
+	}
+}
+
+/*
+ * @brief Configures the ADC for PRS triggered, timed conversions from the asynchronous clock.
+ *
+ * @return void
+ */
+static void _ready_autonomous() {
+	ADC_Init_TypeDef _init_settings = ADC_INIT_DEFAULT;
+	ADC_InitSingle_TypeDef _init_settings_single = ADC_INITSINGLE_DEFAULT;
+
+	/* Run the ADC from AUXHFRCO so it can convert while the HF clocks are off in EM2 */
+	CMU_OscillatorEnable(cmuOsc_AUXHFRCO, true, true);
+	CMU_ClockSelectSet(cmuClock_ADC0ASYNC, cmuSelect_AUXHFRCO);
+	CMU_ClockEnable(cmuClock_ADC0, true);
+	adc_clocked = true;
+
+	_init_settings.em2ClockConfig = adcEm2ClockOnDemand;
+	_init_settings.timebase = ADC_TimebaseCalc(CMU_ClockFreqGet(cmuClock_AUX));
+	_init_settings.prescale = ADC_PrescaleCalc(SOIL_AUTO_ADC_FREQ, CMU_ClockFreqGet(cmuClock_AUX));
+
+	_init_settings_single.diff = false;
+	_init_settings_single.posSel = probes[0].pos_sel;
+	_init_settings_single.negSel = probes[0].neg_sel;
+	_init_settings_single.reference = SOIL_SIGNAL_REF;
+	/* Convert whenever the CRYOTIMER says so, and keep only the freshest results */
+	_init_settings_single.prsEnable = true;
+	_init_settings_single.prsSel = SOIL_PRS_ADC_SEL;
+	_init_settings_single.fifoOverwrite = true;
+
+	/* Hardware oversampling still works unattended; the CPU driven modes don't. */
+	if (sample_mode == soil_sample_hw_oversample) {
+		_init_settings.ovsRateSel = (ADC_OvsRateSel_TypeDef) (ovs_shift - 1);
+		_init_settings_single.resolution = adcResOVS;
+	}
+
+	ADC_Init(ADC0, &_init_settings);
+	ADC_InitSingle(ADC0, &_init_settings_single);
+
+	/* Acquire for as long as the PRS pulse (and so the probe power) is high, convert on the falling edge */
+	ADC0->SINGLECTRLX |= ADC_SINGLECTRLX_PRSMODE_TIMED;
+	/* And compare every result against the window */
+	ADC0->SINGLECTRL |= ADC_SINGLECTRL_CMPEN;
+}
+
+/*
+ * @brief Programs the ADC window comparator. Results at or above high, or at or below low, wake the CPU.
+ *
+ * @param low The lower wake threshold in 12 bit counts.
+ * @param high The upper wake threshold in 12 bit counts. Must be greater than low.
+ *
+ * @return void
+ */
+static void _set_window(uint16_t low, uint16_t high) {
+	uint8_t shift = 0;
+
+	/* Oversampled results are wider than 12 bits, so the thresholds need to be too */
+	if (sample_mode == soil_sample_hw_oversample) {
+		shift = (ovs_shift < 4 ? ovs_shift : 4);
+	}
+
+	/* With ADGT above ADLT, the comparator matches outside the window */
+	ADC0->CMPTHR = (((uint32_t) high << shift) << _ADC_CMPTHR_ADGT_SHIFT)
+			| (((uint32_t) low << shift) << _ADC_CMPTHR_ADLT_SHIFT);
+
+	/* Rearm the wake up */
+	ADC_IntClear(ADC0, ADC_IF_SINGLECMP);
+	ADC_IntEnable(ADC0, ADC_IEN_SINGLECMP);
+}
+
+/*
+ * @brief Hands sampling over to the CRYOTIMER, PRS, and ADC so it runs in EM2 without the CPU.
+ *
+ * The first sample always wakes the CPU; after that, call soil_update_window with each reading
+ * to choose what's worth waking for. Each wake raises the signal given to soil_init and the
+ * reading can be picked up with soil_finish_reading_async as usual.
+ *
+ * @return void
+ */
+void soil_start_autonomous() {
+	CRYOTIMER_Init_TypeDef _cryo_settings = CRYOTIMER_INIT_DEFAULT;
+
+	/* If we're mid-conversion or already running, leave things be */
+	if (converting || autonomous) {
+		return;
+	}
+	autonomous = true;
+	/* The PRS only drives the first probe's power pin */
+	scanning = false;
+	/* And there's nobody awake to measure the supply */
+	supply_mv = 0;
+
+	/* The CPU driven sample modes can't run unattended; fall back to single shots for now */
+	manual_mode = sample_mode;
+	if (sample_mode == soil_sample_burst || sample_mode == soil_sample_dma) {
+		sample_mode = soil_sample_single;
+	}
+
+	/* The ADC can't run in EM3, but EM2 is fine */
+	SLEEP_SleepBlockBegin(sleepEM3);
+
+	/* Throw away any persistent configuration; this needs its own */
+	_shutdown_adc();
+	_ready_autonomous();
+	/* A window that everything falls outside of, so we get a first reading */
+	_set_window(0, 1);
+
+	/* Hand the power pin to the PRS. It drives low whenever the channel is low. */
+	CMU_ClockEnable(cmuClock_PRS, true);
+	GPIO_PinModeSet(SOIL_PWR_PORT, SOIL_PWR_PIN, gpioModePushPull, false);
+	PRS->CH[SOIL_PRS_CHANNEL].CTRL = PRS_CRYOTIMER_PERIOD | PRS_CH_CTRL_ASYNC;
+	PRS->ROUTELOC1 = (PRS->ROUTELOC1 & ~_PRS_ROUTELOC1_CH4LOC_MASK) | SOIL_PRS_POWER_LOC;
+	PRS->ROUTEPEN |= SOIL_PRS_POWER_PEN;
+
+	/* And start the clock */
+	CMU_ClockEnable(cmuClock_CRYOTIMER, true);
+	_cryo_settings.osc = SOIL_AUTO_OSC;
+	_cryo_settings.presc = SOIL_AUTO_PRESC;
+	_cryo_settings.period = SOIL_AUTO_PERIOD;
+	CRYOTIMER_Init(&_cryo_settings);
+}
+
+/*
+ * @brief Moves the autonomous wake window to centre on the last reading.
+ *
+ * The window is clipped so that crossing the alarm level always wakes the CPU, even inside the deadband.
+ *
+ * @param reference The reading to centre the window on.
+ * @param deadband How far the reading may move in either direction before waking the CPU. At least 1.
+ * @param alarm_level The alarm threshold that must always be reported when crossed.
+ *
+ * @return void
+ */
+void soil_update_window(uint16_t reference, uint16_t deadband, uint16_t alarm_level) {
+	uint32_t low;
+	uint32_t high;
+
+	if (!autonomous) {
+		return;
+	}
+	if (deadband < 1) {
+		deadband = 1;
+	}
+
+	low = (reference > deadband) ? (reference - deadband) : 0;
+	high = (uint32_t) reference + deadband;
+
+	/* Going over the alarm level (or back under it) has to wake us */
+	if (reference <= alarm_level) {
+		if (high > (uint32_t) alarm_level + 1) {
+			high = (uint32_t) alarm_level + 1;
+		}
+	} else {
+		if (low < alarm_level) {
+			low = alarm_level;
+		}
+	}
+
+	/* Keep it within what the ADC can produce */
+	if (high > ((1 << SOIL_RESULT_BITS) - 1)) {
+		high = (1 << SOIL_RESULT_BITS) - 1;
+	}
+	if (low >= high) {
+		low = high - 1;
+	}
+
+	_set_window((uint16_t) low, (uint16_t) high);
+}
+
+/*
+ * @brief Stops autonomous sampling and hands the probe and ADC back to the CPU driven modes.
+ *
+ * @return void
+ */
+void soil_stop_autonomous() {
+	if (!autonomous) {
+		return;
+	}
+
+	/* Stop the clock first so nothing new starts */
+	CRYOTIMER_Enable(false);
+	CMU_ClockEnable(cmuClock_CRYOTIMER, false);
+
+	/* Take the pin back from the PRS */
+	PRS->ROUTEPEN &= ~SOIL_PRS_POWER_PEN;
+	PRS->CH[SOIL_PRS_CHANNEL].CTRL = 0;
+	_power_off_sensor();
+
+	/* And shut down the ADC */
+	ADC_IntDisable(ADC0, ADC_IEN_SINGLECMP);
+	_shutdown_adc();
+	CMU_OscillatorEnable(cmuOsc_AUXHFRCO, false, false);
+
+	sample_mode = manual_mode;
+	autonomous = false;
+	SLEEP_SleepBlockEnd(sleepEM3);
+}
+
+/*
+ * @brief Interrupt handler for the ADC. Latches the result and signals the BGAPI.
+ *
+ * @return void
+ */
+void ADC0_IRQHandler() {
+	uint32_t flags = ADC_IntGetEnabled(ADC0);
+
+	/* Clear what we're handling quickly so we can retrigger */
+	ADC_IntClear(ADC0, flags);
+
+	/* If a single conversion finished */
+	if (flags & ADC_IF_SINGLE) {
+		if (measuring_supply) {
+			/* That was AVDD; note it, and move straight on to the probe */
+			measuring_supply = false;
+			supply_mv = (uint16_t) ((ADC_DataSingleGet(ADC0) * SOIL_FIXED_REF_MV) >> SOIL_RESULT_BITS);
+			ADC_IntDisable(ADC0, ADC_IEN_SINGLE);
+			ADC_InitSingle(ADC0, &adc_settings_single);
+			_start_probe_conversion();
+		/* Grab the result (this also clears SINGLEDV) and see if we need more */
+		} else if (_accumulate(ADC_DataSingleGet(ADC0))) {
+			/* Burst mode; go again */
+			ADC_Start(ADC0, adcStartSingle);
+		} else {
+			end_cycles = DWT->CYCCNT;
+			/* and tell the main program about it. */
+			gecko_external_signal(signal_mask);
+		}
+	}
+
+	/* If a scan made it through every probe */
+	if (flags & ADC_IF_SCAN) {
+		uint32_t id;
+		uint32_t sample;
+		uint8_t i;
+
+		/* File each result under the probe it came from */
+		while (ADC0->SCANFIFOCOUNT) {
+			sample = ADC_DataIdScanGet(ADC0, &id);
+			for (i = 0; i < SOIL_PROBE_COUNT; ++i) {
+				if (scan_ids[i] == id) {
+					scan_results[i] = _to_12_bits(sample, false);
+				}
+			}
+		}
+		end_cycles = DWT->CYCCNT;
+		/* and tell the main program about it. */
+		gecko_external_signal(signal_mask);
+	}
+
+	/* If the autonomous sampler saw something worth waking for */
+	if (flags & ADC_IF_SINGLECMP) {
+		uint32_t sample = 0;
+
+		/* Keep the newest result in the FIFO */
+		while (ADC0->SINGLEFIFOCOUNT) {
+			sample = ADC0->SINGLEDATA;
+		}
+		_begin_accumulating();
+		_accumulate((uint16_t) sample);
+		/* The CPU wasn't involved in getting this one */
+		start_cycles = end_cycles = DWT->CYCCNT;
+
+		/* Stop comparing until the main loop moves the window, or we'd fire on every tick. */
+		ADC_IntDisable(ADC0, ADC_IEN_SINGLECMP);
+		/* and tell the main program about it. */
+		gecko_external_signal(signal_mask);
+	}
+}
+
+/*
+ * @brief Interrupt handler for the LDMA. Stops the ADC and signals the BGAPI once a burst lands.
+ *
+ * @return void
+ */
+void LDMA_IRQHandler() {
+	uint32_t flags = LDMA->IF & LDMA->IEN;
+
+	/* Clear what we're handling quickly so we can retrigger */
+	LDMA->IFC = flags;
+
+	/* If our burst is complete */
+	if (flags & _SOIL_DMA_CH_MASK) {
+		/* Stop the ADC from free running while we wait for the main loop */
+		ADC0->CMD = ADC_CMD_SINGLESTOP;
+		end_cycles = DWT->CYCCNT;
+		/* and tell the main program about it. */
+		gecko_external_signal(signal_mask);
+	}
 }
@@ -10,6 +10,10 @@
 #define SRC_SOIL_DRIVER_BT_H_
 
 #include "stdint.h"
+#include "stdbool.h"
+
+#include "em_gpio.h"
+#include "em_adc.h"
 
 #define SOIL_PWR_PORT (gpioPortD)
 #define SOIL_PWR_PIN (10)
@@ -22,18 +26,142 @@
 
 #define SOIL_TIMER_BASE (30)
 
-/* Wait 10ms for the sensor to level out. */
+/* Wait 10ms for the sensor to level out, unless we've learned better. */
 #define SOIL_POWER_ON_TIME (0.010) /* s */
 #define SOIL_POWER_ON_HANDLE (SOIL_TIMER_BASE+0)
 
+/*
+ * Settling detection. While learning, the probe is given a single (never oversampled) conversion every
+ * SOIL_SETTLE_STEP_TIME after power on until SOIL_SETTLE_CONFIRMATIONS conversions in a row agree to
+ * within SOIL_SETTLE_TOLERANCE. The time from power on to the start of the first agreeing conversion
+ * (plus a margin) becomes the power on time for later readings, and the real reading is taken straight
+ * away. Learning repeats once SOIL_SETTLE_RELEARN_INTERVAL has passed so the value follows the soil as
+ * it changes, however often readings are taken.
+ */
+#define SOIL_SETTLE_STEP_TIME (0.001) /* s */
+#define SOIL_SETTLE_MAX_TIME (0.050) /* s; give up and use this if it never settles */
+#define SOIL_SETTLE_MIN_TIME (0.001) /* s */
+#define SOIL_SETTLE_TOLERANCE (8) /* ADC counts */
+#define SOIL_SETTLE_CONFIRMATIONS (2)
+#define SOIL_SETTLE_MARGIN_PERCENT (25)
+#define SOIL_SETTLE_RELEARN_INTERVAL (3600) /* s */
+
 #define SOIL_SIGNAL_POS_MUX (adcPosSelAPORT4XCH3) /* Maps Pin D11 to Bus 4X */
-#define SOIL_SIGNAL_NEG_MUX (adcPosSelAPORT4YCH4) /* Maps Pin D12 to Bus 4Y */
+#define SOIL_SIGNAL_NEG_MUX (adcNegSelAPORT4YCH4) /* Maps Pin D12 to Bus 4Y */
 #define SOIL_SIGNAL_REF (adcRefVDD)
 
+/*
+ * Differential mode reads the probe across its pos/neg inputs against the fixed internal reference
+ * instead of VDD, so common mode noise and the sagging cell don't move the reference. AVDD is
+ * converted in the same wake and readings are scaled back to a fraction of it, which keeps them in
+ * the same 12 bit counts as single ended mode (and keeps alarm levels valid as the battery runs down).
+ * Scans stay single ended against the fixed reference, but are scaled the same way. Autonomous
+ * sampling is always single ended against VDD, since nobody is awake to scale it.
+ */
+typedef enum { soil_measure_single_ended, soil_measure_differential } soil_measure_modes;
+#define SOIL_DEFAULT_MEASURE_MODE (soil_measure_single_ended)
+#define SOIL_DIFF_REF (adcRef5V)
+#define SOIL_SUPPLY_REF (adcRef5V) /* AVDD can only be read against the 5V reference */
+#define SOIL_FIXED_REF_MV (5000) /* mV; full scale of SOIL_DIFF_REF and SOIL_SUPPLY_REF */
+
+/*
+ * The probes on this node. Each has its own power pin and ADC input. Single readings (and
+ * autonomous sampling, whose PRS route is fixed to PD10) use the first probe; scans power every
+ * probe at once, share one settle delay, and convert them all in one ADC scan sequence.
+ *
+ * Probes whose inputs are on the same APORT bus and channel block (CH0-7, CH8-15, ...) can share
+ * a scan input group; otherwise give each block its own group. The scan FIFO holds four results,
+ * so that's as many probes as one scan can take. The mesh layer gives each probe its own element.
+ */
+typedef struct {
+	GPIO_Port_TypeDef pwr_port;
+	uint8_t pwr_pin;
+	ADC_PosSel_TypeDef pos_sel;
+	ADC_NegSel_TypeDef neg_sel;
+	ADC_ScanInputGroup_TypeDef scan_group;
+} soil_probe;
+
+#define SOIL_PROBE_COUNT (1)
+#define SOIL_PROBES { \
+	{ SOIL_PWR_PORT, SOIL_PWR_PIN, SOIL_SIGNAL_POS_MUX, SOIL_SIGNAL_NEG_MUX, adcScanInputGroup0 }, \
+}
+#define SOIL_MAX_SCAN_PROBES (4)
+
+/*
+ * Default noise reduction. Hardware oversampling averages inside the ADC so the CPU is only
+ * woken once per reading; burst mode wakes per conversion but also reports min and max.
+ * Counts are clamped to SOIL_MAX_SAMPLE_COUNT, and rounded down to a power of two in hardware mode.
+ */
+#define SOIL_DEFAULT_SAMPLE_MODE (soil_sample_hw_oversample)
+#define SOIL_DEFAULT_SAMPLE_COUNT (16)
+#define SOIL_MAX_SAMPLE_COUNT (4096)
+#define SOIL_RESULT_BITS (12) /* Means are always reported at the native 12 bit resolution */
+
+/*
+ * DMA mode streams a burst of conversions into RAM with the CPU asleep (in EM1) and only wakes
+ * once at the end. The buffer is static, so SOIL_DMA_MAX_SAMPLES costs two bytes of RAM each.
+ */
+#define SOIL_DMA_CHANNEL (0)
+#define SOIL_DMA_MIN_SAMPLES (32)
+#define SOIL_DMA_MAX_SAMPLES (256)
+
+/*
+ * Autonomous (EM2) sampling. The CRYOTIMER period event is put on a PRS channel that both powers
+ * the probe (PD10 is PRS CH4 location 1) and triggers a timed ADC conversion. In timed mode the ADC
+ * acquires for as long as the PRS signal is high, so the probe is powered and settling for exactly
+ * one prescaled CRYOTIMER tick and the conversion happens as it drops. The CPU is only woken when
+ * the ADC window comparator trips.
+ */
+#define SOIL_PRS_CHANNEL (4)
+#define SOIL_PRS_POWER_LOC (PRS_ROUTELOC1_CH4LOC_LOC1)
+#define SOIL_PRS_POWER_PEN (PRS_ROUTEPEN_CH4PEN)
+#define SOIL_PRS_ADC_SEL (adcPRSSELCh4)
+#define SOIL_AUTO_OSC (cryotimerOscULFRCO) /* ~1 kHz, always available in EM2 */
+#define SOIL_AUTO_PRESC (cryotimerPresc_8) /* ~8 ms ticks; this is the probe on time */
+#define SOIL_AUTO_PERIOD (cryotimerPeriod_512) /* ~4.1 s between samples */
+#define SOIL_AUTO_ADC_FREQ (1000000) /* Hz, ADC clock from AUXHFRCO while in EM2 */
+
+/*
+ * How the ADC is kept between readings. Cold mode initializes and resets the ADC every reading
+ * from HFPERCLK, so the core has to stay in EM1 while it converts. The persistent modes configure
+ * the ADC once, clock it on demand from AUXHFRCO so conversions (and the idle time between them)
+ * can happen in EM2, and choose how much of the ADC to leave powered: standby wakes faster than
+ * cold, warm is fastest but draws the most between readings.
+ */
+typedef enum { soil_adc_cold, soil_adc_keep_standby, soil_adc_keep_warm } soil_adc_power_modes;
+#define SOIL_DEFAULT_ADC_POWER_MODE (soil_adc_cold)
+#define SOIL_ADC_FREQ (400000) /* Hz */
+
+typedef enum { soil_sample_single, soil_sample_hw_oversample, soil_sample_burst, soil_sample_dma } soil_sample_modes;
+
+typedef struct {
+	uint16_t mean; /* The averaged reading in 12 bit ADC counts */
+	uint16_t min; /* The smallest conversion seen (equal to mean for hardware oversampling) */
+	uint16_t max; /* The largest conversion seen (equal to mean for hardware oversampling) */
+	uint16_t median; /* The middle conversion. Only measured in DMA mode, otherwise equal to mean */
+	uint32_t variance; /* Population variance in counts squared. Zero for hardware oversampling */
+	uint16_t count; /* How many conversions went into the reading */
+	uint32_t cycles; /* Awake CPU cycles from starting the ADC to the result landing (the counter stops in sleep) */
+	uint16_t supply_mv; /* AVDD measured in the same wake. Only measured in differential mode, otherwise 0 */
+} soil_reading;
 
-void soil_init();
-uint16_t soil_get_reading_sync();
+void soil_init(const uint32_t event_signal_mask);
+void soil_set_sampling(soil_sample_modes mode, uint16_t count);
+uint16_t soil_get_sample_count();
+soil_sample_modes soil_get_sample_mode();
+void soil_set_adc_power_mode(soil_adc_power_modes mode);
+void soil_set_measure_mode(soil_measure_modes mode);
+void soil_get_reading_sync(soil_reading *reading);
 void soil_start_reading_async();
-uint16_t soil_finish_reading_async();
+void soil_start_conversion_async();
+bool soil_finish_reading_async(soil_reading *reading);
+void soil_start_scan_async();
+bool soil_finish_scan_async(soil_reading readings[SOIL_PROBE_COUNT]);
+void soil_start_learning();
+void soil_set_settle_time(uint32_t ticks);
+uint32_t soil_get_settle_time();
+void soil_start_autonomous();
+void soil_update_window(uint16_t reference, uint16_t deadband, uint16_t alarm_level);
+void soil_stop_autonomous();
 
 #endif /* SRC_SOIL_DRIVER_BT_H_ */
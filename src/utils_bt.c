@@ -10,6 +10,7 @@
 #define SRC_UTILS_C_
 
 #include <stdint.h>
+#include "em_device.h"
 #include "utils_bt.h"
 #include "math.h"
 
@@ -119,4 +120,18 @@ float IEEE_11073_to_IEEE_754(IEEE_11073_FLOAT raw_11073) {
 	return ((float) significand) * pow(10.0,(float)((int8_t) (raw_11073>>24)));
 }
 
+/*
+ * @brief Starts the core's cycle counter, for anything that wants to time itself.
+ *
+ * Safe to call from every module that uses the counter. It's never reset, so nobody's measurement
+ * gets cut short by someone else starting up; take the difference of two readings instead, which
+ * comes out right across a wrap too.
+ *
+ * @return void
+ */
+void enable_cycle_counter() {
+	CoreDebug->DEMCR |= CoreDebug_DEMCR_TRCENA_Msk;
+	DWT->CTRL |= DWT_CTRL_CYCCNTENA_Msk;
+}
+
 #endif /* SRC_UTILS_C_ */
@@ -130,5 +130,6 @@ void bt_16bit_to_128bit_uuid(const uint8 *small_uuid, uuid_128 *large_uuid);
 int bt_compare_uuids(const uint8_t *uuid1, const uuid_128 *uuid2);
 int bt_compare_16bit_uuids(const uint8_t *uuid1, const uuid_16 *uuid2);
 float IEEE_11073_to_IEEE_754(IEEE_11073_FLOAT raw_11073);
+void enable_cycle_counter();
 
 #endif /* SRC_UTILS_BT_H_ */
@@ -0,0 +1,202 @@
+/*
+ * @file valve_module.c
+ * @brief Valve Module. Drives a group of valves straight from the alarm state through a
+ *     Generic OnOff Client, so the irrigation reacts in one mesh hop.
+ *
+ * @author agent
+ * @date Oct 15, 2026
+ */
+
+/* Standard Libraries */
+#include "stdint.h"
+#include "stdbool.h"
+
+/* Bluetooth stack headers */
+#include "bg_types.h"
+#include "native_gecko.h"
+#include <mesh_generic_model_capi_types.h>
+#include <mesh_lib.h>
+
+#include "valve_module.h"
+#include "settings_module.h"
+
+#include "utils_bt.h"
+#include "debug.h"
+#include "user_signals_bt.h"
+
+#define VALVE_VERSION (1)
+
+typedef PACKSTRUCT(struct {
+	uint16_t dead_time; /* s */
+}) valve_settings;
+
+static valve_settings settings;
+
+/* What each probe's alarm says */
+static bool wet[SOIL_PROBE_COUNT];
+
+static bool ready = false; /* Whether we're on the network and can publish */
+static bool sent = false; /* Whether anything has been sent since boot */
+static bool on = false; /* What was last sent */
+static bool holding = false; /* Whether the dead time is running */
+static uint8_t transaction_id = 0;
+
+static void _apply();
+static bool _send(bool open);
+
+/*
+ * @brief Sends the valves whatever the alarms call for, unless it's already been sent or they were
+ * switched too recently.
+ *
+ * @return void
+ */
+static void _apply() {
+	bool open = true;
+	uint8_t probe;
+
+	if (!ready || holding) {
+		return;
+	}
+
+	/* Any wet probe is enough to shut them */
+	for (probe = 0; probe < SOIL_PROBE_COUNT; ++probe) {
+		if (wet[probe]) {
+			open = false;
+		}
+	}
+
+	if (sent && open == on) {
+		return;
+	}
+
+	/* If it didn't go out, the next reading will try again */
+	if (!_send(open)) {
+		return;
+	}
+	sent = true;
+	on = open;
+
+	/* Leave them be for a while */
+	if (settings.dead_time > 0) {
+		uint16_t dead_time = settings.dead_time;
+		holding = true;
+		DEBUG_ASSERT_BGAPI_SUCCESS(
+				gecko_cmd_hardware_set_soft_timer(GET_SOFT_TIMER_COUNTS(dead_time), VALVE_DEAD_TIME_HANDLE, SOFT_TIMER_ONE_SHOT)
+				->result, "Failed to start valve dead time timer.");
+	}
+}
+
+/*
+ * @brief Publishes a Generic OnOff Set Unacknowledged to the valve group.
+ *
+ * @param open True to turn the valves on, false to turn them off.
+ *
+ * @return True if it went out.
+ */
+static bool _send(bool open) {
+	struct mesh_generic_request request;
+	errorcode_t result;
+
+	request.kind = mesh_generic_request_on_off;
+	request.on_off = open ? MESH_GENERIC_ON_OFF_STATE_ON : MESH_GENERIC_ON_OFF_STATE_OFF;
+
+	/* A new transaction each time, so the valves don't take it for a repeat */
+	result = mesh_lib_generic_client_publish(MESH_GENERIC_ON_OFF_CLIENT_MODEL_ID, VALVE_ELEMENT_INDEX, 0,
+			++transaction_id, &request, 0, 0, 0);
+	if (result != bg_err_success) {
+		debug_log("Failed to switch the valves. Result: 0x%04X", result);
+		return false;
+	}
+
+	debug_log("Valves %s.", open ? "opened" : "shut");
+	return true;
+}
+
+/*
+ * @brief Takes in a probe's alarm state and switches the valves if they need it.
+ *
+ * @param probe Which probe.
+ * @param is_wet Whether the probe's wet alarm is set.
+ *
+ * @return void
+ */
+void valve_update(uint8_t probe, bool is_wet) {
+	if (probe >= SOIL_PROBE_COUNT) {
+		return;
+	}
+
+	wet[probe] = is_wet;
+	_apply();
+}
+
+/*
+ * @brief Gets how long the valves are left alone after they're switched.
+ *
+ * @return The dead time in s.
+ */
+uint16_t valve_get_dead_time() {
+	return settings.dead_time;
+}
+
+/*
+ * @brief Changes how long the valves are left alone after they're switched, and saves it once things
+ * settle down. A dead time that's already running isn't cut short.
+ *
+ * @param dead_time The dead time in s. 0 for none.
+ *
+ * @return void
+ */
+void valve_set_dead_time(uint16_t dead_time) {
+	settings.dead_time = dead_time;
+	settings_mark_dirty(VALVE_FLASH_KEY);
+}
+
+/*
+ * @brief Responds to events generated by the BGAPI message queue
+ * that are related to the valve module.
+ *
+ * @param evt_id The ID of the event.
+ * @param evt A pointer to the structure holding the event data.
+ *
+ * @return void
+ */
+void valve_handle_events(uint32_t evt_id, struct gecko_cmd_packet *evt) {
+	switch(evt_id) {
+		case gecko_evt_system_external_signal_id:
+			if (evt->data.evt_system_external_signal.extsignals & CORE_EVT_BOOT) {
+				settings.dead_time = VALVE_DEAD_TIME;
+				settings_register(VALVE_FLASH_KEY, VALVE_VERSION, &settings, sizeof(settings), NULL);
+				settings_load(VALVE_FLASH_KEY);
+				DEBUG_ASSERT_BGAPI_SUCCESS(gecko_cmd_mesh_generic_client_init()
+						->result, "Failed to init Generic Mesh Client");
+			}
+			if (evt->data.evt_system_external_signal.extsignals & CORE_EVT_NETWORK_READY) {
+				/* The next reading sets the valves, whatever we sent before a reset */
+				ready = true;
+			}
+			break;
+
+		case gecko_evt_hardware_soft_timer_id:
+			if (evt->data.evt_hardware_soft_timer.handle == VALVE_DEAD_TIME_HANDLE) {
+				/* Catch up with anything that changed while we were waiting */
+				holding = false;
+				_apply();
+			}
+			break;
+
+		default:
+			break;
+	}
+}
+
+/* What valve_handle_events handles, so the router only hands it those */
+static const uint8_t subscribed_timers[] = {
+		VALVE_DEAD_TIME_HANDLE
+};
+
+const router_subscription valve_subscription = {
+		valve_handle_events,
+		NULL, 0,
+		subscribed_timers, ROUTER_COUNT(subscribed_timers),
+		CORE_EVT_BOOT | CORE_EVT_NETWORK_READY
+};
@@ -0,0 +1,43 @@
+/*
+ * @file valve_module.h
+ * @brief Valve Module. Drives a group of valves straight from the alarm state through a
+ *     Generic OnOff Client, so the irrigation reacts in one mesh hop.
+ *
+ * @author agent
+ * @date Oct 15, 2026
+ */
+
+#ifndef SRC_VALVE_MODULE_H_
+#define SRC_VALVE_MODULE_H_
+
+#include "stdint.h"
+#include "stdbool.h"
+#include "native_gecko.h"
+
+#include "router_module.h"
+
+#include "soil_driver_bt.h"
+
+/*
+ * The valves are whatever subscribes to the OnOff Client's publication address, which is set up by
+ * the provisioner like any other publication. They're opened (On) while every probe is dry and shut
+ * (Off) as soon as any probe raises its wet alarm. Once they've been switched they're left alone for
+ * VALVE_DEAD_TIME so a reading wobbling around the alarm can't work them back and forth; whatever the
+ * alarms want by the end of it is sent then. 0 turns the dead time off.
+ */
+#define VALVE_ELEMENT_INDEX (0)
+#define VALVE_DEAD_TIME (60) /* s */
+
+#define VALVE_FLASH_KEY (0x4003)
+
+#define VALVE_TIMER_HANDLE_BASE (40)
+#define VALVE_DEAD_TIME_HANDLE (VALVE_TIMER_HANDLE_BASE + 0)
+
+void valve_update(uint8_t probe, bool wet);
+uint16_t valve_get_dead_time();
+void valve_set_dead_time(uint16_t dead_time);
+void valve_handle_events(uint32_t evt_id, struct gecko_cmd_packet *evt);
+
+extern const router_subscription valve_subscription;
+
+#endif /* SRC_VALVE_MODULE_H_ */
@@ -0,0 +1,30 @@
+#ifndef BENCH_H
+#define BENCH_H
+
+#include <stdint.h>
+#include <stdlib.h>
+#include <time.h>
+
+/* Shared by the benchmarks. Results go into bench_sink so the compiler
+   can't drop the work being timed. */
+
+#define BENCH_DEFAULT_ITERATIONS 1000000UL
+
+extern volatile uint32_t bench_sink;
+
+static inline uint64_t bench_now_ns(void)
+{
+  struct timespec ts;
+
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return (uint64_t)ts.tv_sec * 1000000000u + (uint64_t)ts.tv_nsec;
+}
+
+static inline unsigned long bench_iterations(int argc, char **argv)
+{
+  unsigned long n = (argc > 1) ? strtoul(argv[1], NULL, 0) : 0;
+
+  return n ? n : BENCH_DEFAULT_ITERATIONS;
+}
+
+#endif // BENCH_H
@@ -0,0 +1,135 @@
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "bg_types.h"
+#include "gecko_bglib.h"
+#include "host_gecko.h"
+#include "mesh_generic_model_capi_types.h"
+#include "mesh_lib.h"
+#include "bench.h"
+
+/* What it costs mesh_lib to dispatch a client request, against how many
+   models are registered. The first MODELS_PER_ELEMENT models are SIG
+   generic models on element 0 and land in the direct-mapped table; the
+   rest go on the elements after it and are hashed. Each event goes to
+   the next registered model in turn, and a request for a model nobody
+   registered is timed as well. The decode is an on/off set, one byte, so
+   the table lookup is most of what's measured. The optional argument is
+   how many events to time per model count. */
+
+#define MODELS_PER_ELEMENT 16
+#define MAX_MODELS 256
+
+volatile uint32_t bench_sink;
+
+static const size_t model_counts[] = { 1, 4, 16, 64, 256 };
+
+static struct gecko_cmd_packet events[MAX_MODELS];
+static struct gecko_cmd_packet miss;
+
+static void on_request(uint16_t model_id,
+                       uint16_t element_index,
+                       uint16_t client_addr,
+                       uint16_t server_addr,
+                       uint16_t appkey_index,
+                       const struct mesh_generic_request *req,
+                       uint32_t transition_ms,
+                       uint16_t delay_ms,
+                       uint8_t request_flags)
+{
+  (void)client_addr;
+  (void)server_addr;
+  (void)appkey_index;
+  (void)transition_ms;
+  (void)delay_ms;
+  (void)request_flags;
+  bench_sink += model_id + element_index + req->on_off;
+}
+
+static void on_change(uint16_t model_id,
+                      uint16_t element_index,
+                      const struct mesh_generic_state *current,
+                      const struct mesh_generic_state *target,
+                      uint32_t remaining_ms)
+{
+  (void)model_id;
+  (void)element_index;
+  (void)current;
+  (void)target;
+  (void)remaining_ms;
+}
+
+static void build_event(struct gecko_cmd_packet *evt, uint16_t model_id, uint16_t elem_index)
+{
+  memset(evt, 0, sizeof(*evt));
+  evt->header = gecko_evt_mesh_generic_server_client_request_id;
+  evt->data.evt_mesh_generic_server_client_request.model_id = model_id;
+  evt->data.evt_mesh_generic_server_client_request.elem_index = elem_index;
+  evt->data.evt_mesh_generic_server_client_request.type = mesh_generic_request_on_off;
+  evt->data.evt_mesh_generic_server_client_request.parameters.len = 1;
+  evt->data.evt_mesh_generic_server_client_request.parameters.data[0] = 1;
+}
+
+static int setup(size_t models)
+{
+  uint16_t model_id;
+  uint16_t elem_index;
+  size_t i;
+
+  if (mesh_lib_init(malloc, free, models) != bg_err_success) {
+    return -1;
+  }
+  for (i = 0; i < models; i++) {
+    model_id = (uint16_t)(MESH_GENERIC_ON_OFF_SERVER_MODEL_ID + i % MODELS_PER_ELEMENT);
+    elem_index = (uint16_t)(i / MODELS_PER_ELEMENT);
+    if (mesh_lib_generic_server_register_handler(model_id, elem_index,
+                                                 on_request, on_change) != bg_err_success) {
+      return -1;
+    }
+    build_event(&events[i], model_id, elem_index);
+  }
+  // an element nothing was registered on
+  build_event(&miss, MESH_GENERIC_ON_OFF_SERVER_MODEL_ID, MAX_MODELS / MODELS_PER_ELEMENT);
+  return 0;
+}
+
+int main(int argc, char **argv)
+{
+  unsigned long n = bench_iterations(argc, argv);
+  uint64_t start;
+  uint64_t hit_ns;
+  uint64_t miss_ns;
+  unsigned long i;
+  size_t c;
+  size_t models;
+
+  printf("%lu events per model count\n\n", n);
+  printf("%8s %12s %12s\n", "models", "ns/event", "ns/miss");
+  for (c = 0; c < sizeof(model_counts) / sizeof(model_counts[0]); c++) {
+    models = model_counts[c];
+    if (setup(models) != 0) {
+      printf("%8u couldn't register\n", (unsigned)models);
+      mesh_lib_deinit();
+      return 1;
+    }
+
+    start = bench_now_ns();
+    for (i = 0; i < n; i++) {
+      mesh_lib_generic_server_event_handler(&events[i % models]);
+    }
+    hit_ns = bench_now_ns() - start;
+
+    start = bench_now_ns();
+    for (i = 0; i < n; i++) {
+      mesh_lib_generic_server_event_handler(&miss);
+    }
+    miss_ns = bench_now_ns() - start;
+
+    printf("%8u %12.1f %12.1f\n", (unsigned)models,
+           (double)hit_ns / (double)n, (double)miss_ns / (double)n);
+    mesh_lib_deinit();
+  }
+  return 0;
+}
@@ -0,0 +1,121 @@
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+
+#include "mesh_generic_model_capi_types.h"
+#include "mesh_serdeser.h"
+#include "kinds.h"
+#include "bench.h"
+
+/* Messages per second through the codec for every kind, decoding and
+   encoding the shortest message the kind takes. Run it before and after
+   a codec change, on the same machine; the absolute numbers only mean
+   something next to each other. The optional argument is how many
+   messages to time per kind. */
+
+volatile uint32_t bench_sink;
+
+static double rate(unsigned long n, uint64_t ns)
+{
+  return ns ? (double)n * 1e9 / (double)ns : 0.0;
+}
+
+static void bench_request(const struct kind *k, const uint8_t *msg, unsigned long n)
+{
+  struct mesh_generic_request req;
+  uint8_t out[KIND_MAX_LEN];
+  uint64_t start;
+  uint64_t decode_ns;
+  uint64_t encode_ns;
+  size_t len;
+  size_t used = 0;
+  unsigned long i;
+
+  for (len = 0; len <= KIND_MAX_LEN; len++) {
+    if (mesh_lib_deserialize_request(&req, k->kind, msg, len) == 0) {
+      break;
+    }
+  }
+  if (len > KIND_MAX_LEN) {
+    printf("%-44s not decoded\n", k->name);
+    return;
+  }
+
+  start = bench_now_ns();
+  for (i = 0; i < n; i++) {
+    bench_sink += mesh_lib_deserialize_request(&req, k->kind, msg, len);
+  }
+  decode_ns = bench_now_ns() - start;
+
+  start = bench_now_ns();
+  for (i = 0; i < n; i++) {
+    bench_sink += mesh_lib_serialize_request(&req, out, sizeof(out), &used);
+  }
+  encode_ns = bench_now_ns() - start;
+  bench_sink += out[0] + used;
+
+  printf("%-44s %3u %12.0f %12.0f\n", k->name, (unsigned)len,
+         rate(n, decode_ns), rate(n, encode_ns));
+}
+
+static void bench_state(const struct kind *k, const uint8_t *msg, unsigned long n)
+{
+  struct mesh_generic_state current;
+  struct mesh_generic_state target;
+  uint8_t out[KIND_MAX_LEN];
+  uint64_t start;
+  uint64_t decode_ns;
+  uint64_t encode_ns;
+  int has_target = 0;
+  size_t len;
+  size_t used = 0;
+  unsigned long i;
+
+  for (len = 0; len <= KIND_MAX_LEN; len++) {
+    if (mesh_lib_deserialize_state(&current, &target, &has_target, k->kind, msg, len) == 0) {
+      break;
+    }
+  }
+  if (len > KIND_MAX_LEN) {
+    printf("%-44s not decoded\n", k->name);
+    return;
+  }
+
+  start = bench_now_ns();
+  for (i = 0; i < n; i++) {
+    bench_sink += mesh_lib_deserialize_state(&current, &target, &has_target, k->kind, msg, len);
+  }
+  decode_ns = bench_now_ns() - start;
+
+  start = bench_now_ns();
+  for (i = 0; i < n; i++) {
+    bench_sink += mesh_lib_serialize_state(&current, has_target ? &target : NULL,
+                                           out, sizeof(out), &used);
+  }
+  encode_ns = bench_now_ns() - start;
+  bench_sink += out[0] + used;
+
+  printf("%-44s %3u %12.0f %12.0f\n", k->name, (unsigned)len,
+         rate(n, decode_ns), rate(n, encode_ns));
+}
+
+int main(int argc, char **argv)
+{
+  unsigned long n = bench_iterations(argc, argv);
+  uint8_t msg[KIND_MAX_LEN];
+  size_t i;
+
+  for (i = 0; i < sizeof(msg); i++) {
+    msg[i] = (uint8_t)(0x11 * (i + 1));
+  }
+
+  printf("%lu messages per kind\n\n", n);
+  printf("%-44s %3s %12s %12s\n", "kind", "len", "decode/s", "encode/s");
+  for (i = 0; i < request_kind_count; i++) {
+    bench_request(&request_kinds[i], msg, n);
+  }
+  for (i = 0; i < state_kind_count; i++) {
+    bench_state(&state_kinds[i], msg, n);
+  }
+  return 0;
+}
@@ -0,0 +1,121 @@
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+
+#include "mesh_generic_model_capi_types.h"
+#include "mesh_serdeser.h"
+#include "kinds.h"
+#include "bench.h"
+
+/* Nanoseconds per received message for every kind, read the two ways a
+   handler can: decoded into the mesh_generic_request or mesh_generic_state
+   union, or opened as a view. Either way the handler then reads the first
+   byte of the first field, so the view isn't credited for skipping work
+   a handler would do. The message is the shortest one the kind takes.
+   The optional argument is how many messages to time per kind. */
+
+volatile uint32_t bench_sink;
+
+static void bench_request(const struct kind *k, const uint8_t *msg, unsigned long n)
+{
+  struct mesh_generic_request req;
+  struct mesh_lib_view view;
+  uint64_t start;
+  uint64_t union_ns;
+  uint64_t view_ns;
+  size_t len;
+  unsigned long i;
+
+  for (len = 0; len <= KIND_MAX_LEN; len++) {
+    if (mesh_lib_deserialize_request(&req, k->kind, msg, len) == 0) {
+      break;
+    }
+  }
+  if (len > KIND_MAX_LEN) {
+    printf("%-44s not decoded\n", k->name);
+    return;
+  }
+
+  start = bench_now_ns();
+  for (i = 0; i < n; i++) {
+    if (mesh_lib_deserialize_request(&req, k->kind, msg, len) == 0) {
+      bench_sink += req.on_off;
+    }
+  }
+  union_ns = bench_now_ns() - start;
+
+  start = bench_now_ns();
+  for (i = 0; i < n; i++) {
+    if (mesh_lib_view_request(&view, k->kind, msg, len) == 0) {
+      bench_sink += mesh_lib_view_u8(&view, 0);
+    }
+  }
+  view_ns = bench_now_ns() - start;
+
+  printf("%-44s %3u %10.2f %10.2f\n", k->name, (unsigned)len,
+         (double)union_ns / (double)n, (double)view_ns / (double)n);
+}
+
+static void bench_state(const struct kind *k, const uint8_t *msg, unsigned long n)
+{
+  struct mesh_generic_state current;
+  struct mesh_generic_state target;
+  struct mesh_lib_view current_view;
+  struct mesh_lib_view target_view;
+  uint64_t start;
+  uint64_t union_ns;
+  uint64_t view_ns;
+  int has_target;
+  size_t len;
+  unsigned long i;
+
+  for (len = 0; len <= KIND_MAX_LEN; len++) {
+    if (mesh_lib_deserialize_state(&current, &target, &has_target, k->kind, msg, len) == 0) {
+      break;
+    }
+  }
+  if (len > KIND_MAX_LEN) {
+    printf("%-44s not decoded\n", k->name);
+    return;
+  }
+
+  start = bench_now_ns();
+  for (i = 0; i < n; i++) {
+    if (mesh_lib_deserialize_state(&current, &target, &has_target, k->kind, msg, len) == 0) {
+      bench_sink += current.on_off.on;
+    }
+  }
+  union_ns = bench_now_ns() - start;
+
+  start = bench_now_ns();
+  for (i = 0; i < n; i++) {
+    if (mesh_lib_view_state(&current_view, &target_view, &has_target, k->kind, msg, len) == 0) {
+      bench_sink += mesh_lib_view_u8(&current_view, 0);
+    }
+  }
+  view_ns = bench_now_ns() - start;
+
+  printf("%-44s %3u %10.2f %10.2f\n", k->name, (unsigned)len,
+         (double)union_ns / (double)n, (double)view_ns / (double)n);
+}
+
+int main(int argc, char **argv)
+{
+  unsigned long n = bench_iterations(argc, argv);
+  uint8_t msg[KIND_MAX_LEN];
+  size_t i;
+
+  for (i = 0; i < sizeof(msg); i++) {
+    msg[i] = (uint8_t)(0x11 * (i + 1));
+  }
+
+  printf("%lu messages per kind, ns per message\n\n", n);
+  printf("%-44s %3s %10s %10s\n", "kind", "len", "union", "view");
+  for (i = 0; i < request_kind_count; i++) {
+    bench_request(&request_kinds[i], msg, n);
+  }
+  for (i = 0; i < state_kind_count; i++) {
+    bench_state(&state_kinds[i], msg, n);
+  }
+  return 0;
+}
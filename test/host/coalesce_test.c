@@ -0,0 +1,166 @@
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "bg_types.h"
+#include "gecko_bglib.h"
+#include "host_gecko.h"
+#include "mesh_generic_model_capi_types.h"
+#include "mesh_lib.h"
+#include "mesh_serdeser.h"
+
+/* State change coalescing test, built with
+   MESH_LIB_COALESCE_STATE_CHANGES. A Generic Power Level Server has
+   several states, and changes to them arrive back to back the way the
+   stack queues them up. After a flush the application has to have
+   seen the newest value of every state that changed, in the order the
+   states first changed, and nothing twice. */
+
+#define SERVER_MODEL MESH_GENERIC_POWER_LEVEL_SERVER_MODEL_ID
+#define MAX_SEEN 8
+
+struct seen {
+  mesh_generic_state_t kind;
+  uint16_t level;
+  uint32_t remaining_ms;
+};
+
+static struct seen seen[MAX_SEEN];
+static size_t seen_count = 0;
+static unsigned long checks = 0;
+static unsigned long failures = 0;
+
+static void check(int ok, const char *what)
+{
+  checks++;
+  if (!ok) {
+    failures++;
+    printf("FAIL: %s\n", what);
+  }
+}
+
+static void on_request(uint16_t model_id,
+                       uint16_t element_index,
+                       uint16_t client_addr,
+                       uint16_t server_addr,
+                       uint16_t appkey_index,
+                       const struct mesh_generic_request *req,
+                       uint32_t transition_ms,
+                       uint16_t delay_ms,
+                       uint8_t request_flags)
+{
+  (void)model_id;
+  (void)element_index;
+  (void)client_addr;
+  (void)server_addr;
+  (void)appkey_index;
+  (void)req;
+  (void)transition_ms;
+  (void)delay_ms;
+  (void)request_flags;
+}
+
+static void on_change(uint16_t model_id,
+                      uint16_t element_index,
+                      const struct mesh_generic_state *current,
+                      const struct mesh_generic_state *target,
+                      uint32_t remaining_ms)
+{
+  (void)model_id;
+  (void)element_index;
+  (void)target;
+  if (seen_count < MAX_SEEN) {
+    seen[seen_count].kind = current->kind;
+    // every power level state keeps its level in the same place
+    seen[seen_count].level = current->power_level.level;
+    seen[seen_count].remaining_ms = remaining_ms;
+  }
+  seen_count++;
+}
+
+static void state_changed(mesh_generic_state_t kind, uint16_t level, uint32_t remaining_ms)
+{
+  struct mesh_generic_state current;
+  struct gecko_cmd_packet evt;
+  struct gecko_msg_mesh_generic_server_state_changed_evt_t *chg;
+  uint8_t msg[16];
+  size_t len;
+
+  memset(&current, 0, sizeof(current));
+  current.kind = kind;
+  current.power_level.level = level;
+
+  memset(&evt, 0, sizeof(evt));
+  evt.header = gecko_evt_mesh_generic_server_state_changed_id;
+  chg = &evt.data.evt_mesh_generic_server_state_changed;
+  chg->model_id = SERVER_MODEL;
+  chg->type = kind;
+  chg->remaining = remaining_ms;
+  if (mesh_lib_serialize_state(&current, NULL, msg, sizeof(msg), &len) != 0) {
+    printf("can't encode state 0x%02x\n", kind);
+    exit(1);
+  }
+  chg->parameters.len = len;
+  memcpy(chg->parameters.data, msg, len);
+  mesh_lib_generic_server_event_handler(&evt);
+}
+
+static int saw(size_t i, mesh_generic_state_t kind, uint16_t level)
+{
+  return i < seen_count && seen[i].kind == kind && seen[i].level == level;
+}
+
+// Repeated changes to one state collapse into the newest
+static void test_same_state(void)
+{
+  struct mesh_lib_coalesce_stats stats;
+
+  seen_count = 0;
+  state_changed(mesh_generic_state_power_level, 100, 500);
+  state_changed(mesh_generic_state_power_level, 200, 400);
+  state_changed(mesh_generic_state_power_level, 300, 300);
+  check(seen_count == 0, "same state: delivered before the flush");
+  mesh_lib_generic_server_flush();
+  check(seen_count == 1, "same state: not collapsed into one");
+  check(saw(0, mesh_generic_state_power_level, 300), "same state: newest value lost");
+  check(seen[0].remaining_ms == 300, "same state: remaining time isn't the newest");
+
+  mesh_lib_get_coalesce_stats(&stats);
+  check(stats.held == 3 && stats.collapsed == 2 && stats.delivered == 1,
+        "same state: counted wrong");
+}
+
+// A change to another state of the same model doesn't replace the held one
+static void test_other_state(void)
+{
+  seen_count = 0;
+  state_changed(mesh_generic_state_power_level, 1000, 0);
+  state_changed(mesh_generic_state_power_level_last, 2000, 0);
+  check(seen_count == 1, "other state: the held change isn't delivered first");
+  check(saw(0, mesh_generic_state_power_level, 1000), "other state: the held change is lost");
+  state_changed(mesh_generic_state_power_level_last, 3000, 0);
+  mesh_lib_generic_server_flush();
+  check(seen_count == 2, "other state: wrong number of changes delivered");
+  check(saw(1, mesh_generic_state_power_level_last, 3000), "other state: newest value lost");
+
+  // and nothing is left to deliver
+  mesh_lib_generic_server_flush();
+  check(seen_count == 2, "other state: delivered twice");
+}
+
+int main(void)
+{
+  if (mesh_lib_init(malloc, free, 1) != bg_err_success
+      || mesh_lib_generic_server_register_handler(SERVER_MODEL, 0, on_request, on_change) != bg_err_success) {
+    printf("mesh_lib wouldn't start\n");
+    return 1;
+  }
+
+  test_same_state();
+  test_other_state();
+  mesh_lib_deinit();
+
+  printf("%lu checks, %lu failed\n", checks, failures);
+  return failures ? 1 : 0;
+}
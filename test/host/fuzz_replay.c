@@ -0,0 +1,133 @@
+#include <dirent.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/stat.h>
+
+/* Stands in for libFuzzer where there's no clang: runs each file (or
+   every file in each directory) given on the command line through the
+   fuzz target, then with -n, that many random mutations of each. The
+   mutations are seeded, so a failure comes back the same every run. */
+
+int LLVMFuzzerTestOneInput(const uint8_t *data, size_t size);
+
+#define FUZZ_MAX_INPUT 258
+
+static uint32_t rng = 0x2545f491;
+static unsigned long mutations = 0;
+static unsigned long inputs = 0;
+
+static uint32_t next_random(void)
+{
+  rng ^= rng << 13;
+  rng ^= rng >> 17;
+  rng ^= rng << 5;
+  return rng;
+}
+
+static void run(const uint8_t *data, size_t size)
+{
+  uint8_t mutant[FUZZ_MAX_INPUT];
+  size_t len;
+  unsigned long n;
+
+  LLVMFuzzerTestOneInput(data, size);
+  inputs++;
+
+  for (n = 0; n < mutations; n++) {
+    memcpy(mutant, data, size);
+    len = size;
+    switch (next_random() % 4) {
+      case 0: // flip a byte
+        if (len) {
+          mutant[next_random() % len] ^= 1 << (next_random() % 8);
+        }
+        break;
+      case 1: // cut it short
+        if (len) {
+          len = next_random() % len;
+        }
+        break;
+      case 2: // run it long
+        if (len < FUZZ_MAX_INPUT) {
+          mutant[len++] = next_random();
+        }
+        break;
+      case 3: // some other kind
+        if (len > 1) {
+          mutant[1] = next_random();
+        }
+        break;
+    }
+    LLVMFuzzerTestOneInput(mutant, len);
+    inputs++;
+  }
+}
+
+static int run_file(const char *path)
+{
+  uint8_t data[FUZZ_MAX_INPUT];
+  size_t size;
+  FILE *f = fopen(path, "rb");
+
+  if (!f) {
+    perror(path);
+    return -1;
+  }
+  size = fread(data, 1, sizeof(data), f);
+  fclose(f);
+  run(data, size);
+  return 0;
+}
+
+static int run_path(const char *path)
+{
+  char file[1024];
+  struct dirent *entry;
+  struct stat st;
+  DIR *dir;
+  int result = 0;
+
+  if (stat(path, &st) != 0) {
+    perror(path);
+    return -1;
+  }
+  if (!S_ISDIR(st.st_mode)) {
+    return run_file(path);
+  }
+
+  dir = opendir(path);
+  if (!dir) {
+    perror(path);
+    return -1;
+  }
+  while ((entry = readdir(dir)) != NULL) {
+    if (entry->d_name[0] == '.') {
+      continue;
+    }
+    snprintf(file, sizeof(file), "%s/%s", path, entry->d_name);
+    if (run_file(file) != 0) {
+      result = -1;
+    }
+  }
+  closedir(dir);
+  return result;
+}
+
+int main(int argc, char **argv)
+{
+  int result = 0;
+  int i;
+
+  for (i = 1; i < argc; i++) {
+    if (strcmp(argv[i], "-n") == 0 && i + 1 < argc) {
+      mutations = strtoul(argv[++i], NULL, 0);
+    } else if (run_path(argv[i]) != 0) {
+      result = 1;
+    }
+  }
+
+  printf("%lu inputs run\n", inputs);
+  return result;
+}
@@ -0,0 +1,190 @@
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "bg_types.h"
+#include "gecko_bglib.h"
+#include "host_gecko.h"
+#include "mesh_generic_model_capi_types.h"
+#include "mesh_lib.h"
+#include "mesh_serdeser.h"
+
+/* libFuzzer entry point. The input is a direction byte (even for a
+   request, odd for a state), a kind byte, and then the message as it
+   would arrive over the air. Every message goes through the decoder
+   and the view, which have to agree on whether it's valid; a valid one
+   has to encode back to the same bytes. It then goes through mesh_lib's
+   event handlers the way the stack would deliver it. Anything wrong
+   aborts, so libFuzzer keeps the input. */
+
+#define SERVER_MODEL MESH_GENERIC_ON_OFF_SERVER_MODEL_ID
+#define CLIENT_MODEL MESH_GENERIC_ON_OFF_CLIENT_MODEL_ID
+
+static void check(int ok, const char *what, int kind, size_t len)
+{
+  if (!ok) {
+    fprintf(stderr, "%s (kind 0x%02x, %u bytes)\n", what, kind, (unsigned)len);
+    abort();
+  }
+}
+
+static void on_request(uint16_t model_id,
+                       uint16_t element_index,
+                       uint16_t client_addr,
+                       uint16_t server_addr,
+                       uint16_t appkey_index,
+                       const struct mesh_generic_request *req,
+                       uint32_t transition_ms,
+                       uint16_t delay_ms,
+                       uint8_t request_flags)
+{
+  (void)model_id;
+  (void)element_index;
+  (void)client_addr;
+  (void)server_addr;
+  (void)appkey_index;
+  (void)req;
+  (void)transition_ms;
+  (void)delay_ms;
+  (void)request_flags;
+}
+
+static void on_change(uint16_t model_id,
+                      uint16_t element_index,
+                      const struct mesh_generic_state *current,
+                      const struct mesh_generic_state *target,
+                      uint32_t remaining_ms)
+{
+  (void)model_id;
+  (void)element_index;
+  (void)current;
+  (void)target;
+  (void)remaining_ms;
+}
+
+static void on_status(uint16_t model_id,
+                      uint16_t element_index,
+                      uint16_t client_addr,
+                      uint16_t server_addr,
+                      const struct mesh_generic_state *current,
+                      const struct mesh_generic_state *target,
+                      uint32_t remaining_ms,
+                      uint8_t response_flags)
+{
+  (void)model_id;
+  (void)element_index;
+  (void)client_addr;
+  (void)server_addr;
+  (void)current;
+  (void)target;
+  (void)remaining_ms;
+  (void)response_flags;
+}
+
+static void setup(void)
+{
+  static int ready = 0;
+
+  if (ready) {
+    return;
+  }
+  ready = 1;
+  if (mesh_lib_init(malloc, free, 2) != bg_err_success
+      || mesh_lib_generic_server_register_handler(SERVER_MODEL, 0, on_request, on_change) != bg_err_success
+      || mesh_lib_generic_client_register_handler(CLIENT_MODEL, 0, on_status) != bg_err_success) {
+    fprintf(stderr, "mesh_lib wouldn't start\n");
+    abort();
+  }
+}
+
+static void fuzz_request(int kind, const uint8_t *msg, size_t len)
+{
+  struct mesh_generic_request req;
+  struct mesh_lib_view view;
+  struct gecko_cmd_packet evt;
+  uint8_t out[256];
+  size_t used;
+  int r;
+
+  r = mesh_lib_deserialize_request(&req, kind, msg, len);
+  check(r == mesh_lib_view_request(&view, kind, msg, len),
+        "request decoder and view disagree", kind, len);
+  if (r == 0) {
+    check(mesh_lib_serialize_request(&req, out, sizeof(out), &used) == 0,
+          "decoded request won't encode", kind, len);
+    check(used == len && memcmp(out, msg, len) == 0,
+          "request doesn't survive a round trip", kind, len);
+  }
+
+  memset(&evt, 0, sizeof(evt));
+  evt.header = gecko_evt_mesh_generic_server_client_request_id;
+  evt.data.evt_mesh_generic_server_client_request.model_id = SERVER_MODEL;
+  evt.data.evt_mesh_generic_server_client_request.type = kind;
+  evt.data.evt_mesh_generic_server_client_request.parameters.len = len;
+  memcpy(evt.data.evt_mesh_generic_server_client_request.parameters.data, msg, len);
+  mesh_lib_generic_server_event_handler(&evt);
+}
+
+static void fuzz_state(int kind, const uint8_t *msg, size_t len)
+{
+  struct mesh_generic_state current;
+  struct mesh_generic_state target;
+  struct mesh_lib_view current_view;
+  struct mesh_lib_view target_view;
+  struct gecko_cmd_packet evt;
+  uint8_t out[256];
+  size_t used;
+  int has_target;
+  int view_has_target;
+  int r;
+
+  r = mesh_lib_deserialize_state(&current, &target, &has_target, kind, msg, len);
+  check(r == mesh_lib_view_state(&current_view, &target_view, &view_has_target, kind, msg, len),
+        "state decoder and view disagree", kind, len);
+  if (r == 0) {
+    check(has_target == view_has_target,
+          "state decoder and view disagree on the target", kind, len);
+    check(mesh_lib_serialize_state(&current, has_target ? &target : NULL,
+                                   out, sizeof(out), &used) == 0,
+          "decoded state won't encode", kind, len);
+    check(used == len && memcmp(out, msg, len) == 0,
+          "state doesn't survive a round trip", kind, len);
+  }
+
+  memset(&evt, 0, sizeof(evt));
+  evt.header = gecko_evt_mesh_generic_server_state_changed_id;
+  evt.data.evt_mesh_generic_server_state_changed.model_id = SERVER_MODEL;
+  evt.data.evt_mesh_generic_server_state_changed.type = kind;
+  evt.data.evt_mesh_generic_server_state_changed.parameters.len = len;
+  memcpy(evt.data.evt_mesh_generic_server_state_changed.parameters.data, msg, len);
+  mesh_lib_generic_server_event_handler(&evt);
+  mesh_lib_generic_server_flush();
+
+  memset(&evt, 0, sizeof(evt));
+  evt.header = gecko_evt_mesh_generic_client_server_status_id;
+  evt.data.evt_mesh_generic_client_server_status.model_id = CLIENT_MODEL;
+  evt.data.evt_mesh_generic_client_server_status.type = kind;
+  evt.data.evt_mesh_generic_client_server_status.parameters.len = len;
+  memcpy(evt.data.evt_mesh_generic_client_server_status.parameters.data, msg, len);
+  mesh_lib_generic_client_event_handler(&evt);
+}
+
+int LLVMFuzzerTestOneInput(const uint8_t *data, size_t size)
+{
+  size_t len;
+
+  // BGAPI carries at most 255 bytes of parameters
+  if (size < 2 || size - 2 > UINT8_MAX) {
+    return 0;
+  }
+  setup();
+
+  len = size - 2;
+  if (data[0] & 0x01) {
+    fuzz_state(data[1], data + 2, len);
+  } else {
+    fuzz_request(data[1], data + 2, len);
+  }
+  return 0;
+}
@@ -0,0 +1,92 @@
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+
+#include "mesh_generic_model_capi_types.h"
+#include "mesh_serdeser.h"
+#include "kinds.h"
+
+/* Writes the seed corpus into the directory given: for every kind, a
+   message of each of the first two lengths the decoder takes for it.
+   That's the plain message and, where there is one, the message with a
+   target or a value on the end. Files are in the fuzz target's input
+   format, named after the kind and the message length. */
+
+#define LENGTHS_PER_KIND 2
+
+static int write_seed(const char *dir,
+                      const char *name,
+                      int state,
+                      int kind,
+                      const uint8_t *msg,
+                      size_t len)
+{
+  char path[512];
+  uint8_t head[2];
+  FILE *f;
+
+  snprintf(path, sizeof(path), "%s/%s.%u", dir, name, (unsigned)len);
+  f = fopen(path, "wb");
+  if (!f) {
+    perror(path);
+    return -1;
+  }
+  head[0] = state;
+  head[1] = kind;
+  fwrite(head, 1, sizeof(head), f);
+  fwrite(msg, 1, len, f);
+  fclose(f);
+  return 0;
+}
+
+int main(int argc, char **argv)
+{
+  struct mesh_generic_request req;
+  struct mesh_generic_state current;
+  struct mesh_generic_state target;
+  uint8_t msg[KIND_MAX_LEN];
+  int has_target;
+  size_t found;
+  size_t len;
+  size_t i;
+  int seeds = 0;
+
+  if (argc != 2) {
+    fprintf(stderr, "usage: %s corpus-dir\n", argv[0]);
+    return 2;
+  }
+
+  // Something recognisable, and different in every byte
+  for (i = 0; i < sizeof(msg); i++) {
+    msg[i] = (uint8_t)(0x11 * (i + 1));
+  }
+
+  for (i = 0; i < request_kind_count; i++) {
+    found = 0;
+    for (len = 0; len <= KIND_MAX_LEN && found < LENGTHS_PER_KIND; len++) {
+      if (mesh_lib_deserialize_request(&req, request_kinds[i].kind, msg, len) == 0) {
+        if (write_seed(argv[1], request_kinds[i].name, 0, request_kinds[i].kind, msg, len) != 0) {
+          return 1;
+        }
+        found++;
+        seeds++;
+      }
+    }
+  }
+
+  for (i = 0; i < state_kind_count; i++) {
+    found = 0;
+    for (len = 0; len <= KIND_MAX_LEN && found < LENGTHS_PER_KIND; len++) {
+      if (mesh_lib_deserialize_state(&current, &target, &has_target, state_kinds[i].kind, msg, len) == 0) {
+        if (write_seed(argv[1], state_kinds[i].name, 1, state_kinds[i].kind, msg, len) != 0) {
+          return 1;
+        }
+        found++;
+        seeds++;
+      }
+    }
+  }
+
+  printf("%d seeds written to %s\n", seeds, argv[1]);
+  return 0;
+}
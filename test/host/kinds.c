@@ -0,0 +1,63 @@
+#include "kinds.h"
+
+#define KIND(k) { k, #k }
+
+const struct kind request_kinds[] = {
+  KIND(mesh_generic_request_on_off),
+  KIND(mesh_generic_request_on_power_up),
+  KIND(mesh_generic_request_level),
+  KIND(mesh_generic_request_level_delta),
+  KIND(mesh_generic_request_level_move),
+  KIND(mesh_generic_request_level_halt),
+  KIND(mesh_generic_request_power_level),
+  KIND(mesh_generic_request_power_level_default),
+  KIND(mesh_generic_request_power_level_range),
+  KIND(mesh_generic_request_transition_time),
+  KIND(mesh_generic_request_location_global),
+  KIND(mesh_generic_request_location_local),
+  KIND(mesh_generic_request_property_user),
+  KIND(mesh_generic_request_property_admin),
+  KIND(mesh_generic_request_property_manuf),
+  KIND(mesh_lighting_request_lightness_actual),
+  KIND(mesh_lighting_request_lightness_linear),
+  KIND(mesh_lighting_request_lightness_default),
+  KIND(mesh_lighting_request_lightness_range),
+  KIND(mesh_lighting_request_ctl),
+  KIND(mesh_lighting_request_ctl_temperature),
+  KIND(mesh_lighting_request_ctl_default),
+  KIND(mesh_lighting_request_ctl_temperature_range),
+};
+
+const size_t request_kind_count = sizeof(request_kinds) / sizeof(request_kinds[0]);
+
+const struct kind state_kinds[] = {
+  KIND(mesh_generic_state_on_off),
+  KIND(mesh_generic_state_on_power_up),
+  KIND(mesh_generic_state_level),
+  KIND(mesh_generic_state_power_level),
+  KIND(mesh_generic_state_power_level_last),
+  KIND(mesh_generic_state_power_level_default),
+  KIND(mesh_generic_state_power_level_range),
+  KIND(mesh_generic_state_transition_time),
+  KIND(mesh_generic_state_battery),
+  KIND(mesh_generic_state_location_global),
+  KIND(mesh_generic_state_location_local),
+  KIND(mesh_generic_state_property_user),
+  KIND(mesh_generic_state_property_admin),
+  KIND(mesh_generic_state_property_manuf),
+  KIND(mesh_generic_state_property_list_user),
+  KIND(mesh_generic_state_property_list_admin),
+  KIND(mesh_generic_state_property_list_manuf),
+  KIND(mesh_generic_state_property_list_client),
+  KIND(mesh_lighting_state_lightness_actual),
+  KIND(mesh_lighting_state_lightness_linear),
+  KIND(mesh_lighting_state_lightness_last),
+  KIND(mesh_lighting_state_lightness_default),
+  KIND(mesh_lighting_state_lightness_range),
+  KIND(mesh_lighting_state_ctl),
+  KIND(mesh_lighting_state_ctl_temperature),
+  KIND(mesh_lighting_state_ctl_default),
+  KIND(mesh_lighting_state_ctl_temperature_range),
+};
+
+const size_t state_kind_count = sizeof(state_kinds) / sizeof(state_kinds[0]);
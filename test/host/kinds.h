@@ -0,0 +1,25 @@
+#ifndef KINDS_H
+#define KINDS_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include "mesh_generic_model_capi_types.h"
+
+/* Every request and state kind the codec is meant to know, by name,
+   so the tests notice a kind going missing and the benchmarks can say
+   which is which. A new kind in the codec tables wants a line here. */
+struct kind {
+  int kind;
+  const char *name;
+};
+
+extern const struct kind request_kinds[];
+extern const size_t request_kind_count;
+extern const struct kind state_kinds[];
+extern const size_t state_kind_count;
+
+/* The longest message any kind is tried with */
+#define KIND_MAX_LEN 16
+
+#endif // KINDS_H
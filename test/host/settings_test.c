@@ -0,0 +1,116 @@
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+
+#include "moistsrv_settings.h"
+
+/* Migration test for the moisture server's settings record. Records
+   saved by every older firmware go through moistsrv_migrate_settings
+   on top of a record holding the defaults, and what comes out has to
+   behave the way the old node did. Calibration is faked with a curve
+   that's easy to check. */
+
+#define DEFAULT_HYSTERESIS 200
+#define DEFAULT_DEADBAND 0x40
+#define DEFAULT_REL_DELTA 500
+
+static unsigned long checks = 0;
+static unsigned long failures = 0;
+static unsigned long conversions = 0;
+
+uint16_t calib_to_vwc(uint8_t probe, uint16_t counts)
+{
+  (void)probe;
+  conversions++;
+  return counts / 2;
+}
+
+static void check(int ok, const char *what)
+{
+  checks++;
+  if (!ok) {
+    failures++;
+    printf("FAIL: %s\n", what);
+  }
+}
+
+static void defaults(moistsrv_settings *settings)
+{
+  memset(settings, 0, sizeof(*settings));
+  settings->alarm_level = DEFAULT_ALARM_LEVEL;
+  settings->cadence.delta_down = 50;
+  settings->cadence.delta_up = 50;
+  settings->alarm_hysteresis = DEFAULT_HYSTERESIS;
+  settings->autonomous_deadband = DEFAULT_DEADBAND;
+  settings->rel_delta_down = DEFAULT_REL_DELTA;
+  settings->rel_delta_up = DEFAULT_REL_DELTA;
+}
+
+// Before the settings store: just the alarm level, in raw counts
+static void test_version_0(void)
+{
+  moistsrv_settings settings;
+  uint8_t old[2];
+
+  defaults(&settings);
+  old[0] = LEGACY_NO_ALARM & 0xFF;
+  old[1] = LEGACY_NO_ALARM >> 8;
+  conversions = 0;
+  check(moistsrv_migrate_settings(0, old, sizeof(old), &settings), "v0 without an alarm is rejected");
+  check(settings.alarm_level == DEFAULT_ALARM_LEVEL, "v0 without an alarm gets one");
+  check(conversions == 0, "v0 without an alarm goes through the calibration");
+
+  defaults(&settings);
+  old[0] = 0x00;
+  old[1] = 0x08;
+  check(moistsrv_migrate_settings(0, old, sizeof(old), &settings), "v0 alarm level is rejected");
+  check(settings.alarm_level == 0x0400, "v0 alarm level isn't converted to VWC");
+  check(settings.alarm_hysteresis == DEFAULT_HYSTERESIS, "v0 loses a default");
+
+  defaults(&settings);
+  check(!moistsrv_migrate_settings(0, old, 1, &settings), "v0 of the wrong length is taken");
+  check(settings.alarm_level == DEFAULT_ALARM_LEVEL, "a rejected v0 changes the settings");
+}
+
+// Versions 1 and 2 had one pair of deltas, picked by trigger_percent
+static void test_prefix(uint8_t version, uint8_t len)
+{
+  moistsrv_settings old;
+  moistsrv_settings settings;
+
+  defaults(&old);
+  old.alarm_level = 1234;
+  old.alarm_hysteresis = 77;
+  old.autonomous_deadband = 0x10;
+  old.cadence.delta_down = 30;
+  old.cadence.delta_up = 40;
+
+  old.cadence.trigger_percent = false;
+  defaults(&settings);
+  check(moistsrv_migrate_settings(version, (const uint8_t *)&old, len, &settings), "absolute record is rejected");
+  check(settings.alarm_level == 1234 && settings.alarm_hysteresis == 77, "absolute record loses a field");
+  check(settings.cadence.delta_down == 30 && settings.cadence.delta_up == 40, "absolute deltas move");
+  check(settings.rel_delta_down == 0 && settings.rel_delta_up == 0, "relative deltas start publishing");
+  check(settings.autonomous_deadband == (version < 2 ? DEFAULT_DEADBAND : 0x10), "deadband comes out wrong");
+
+  old.cadence.trigger_percent = true;
+  defaults(&settings);
+  check(moistsrv_migrate_settings(version, (const uint8_t *)&old, len, &settings), "relative record is rejected");
+  check(settings.cadence.trigger_percent, "relative record forgets what it carried");
+  check(settings.rel_delta_down == 30 && settings.rel_delta_up == 40, "relative deltas don't move");
+  check(settings.cadence.delta_down == 0 && settings.cadence.delta_up == 0, "absolute deltas start publishing");
+
+  defaults(&settings);
+  check(!moistsrv_migrate_settings(version, (const uint8_t *)&old, len - 1, &settings), "short record is taken");
+  check(!moistsrv_migrate_settings(version + 1, (const uint8_t *)&old, len, &settings), "record of another version is taken");
+}
+
+int main(void)
+{
+  test_version_0();
+  test_prefix(1, MOISTSRV_SETTINGS_V1_SIZE);
+  test_prefix(2, MOISTSRV_SETTINGS_V2_SIZE);
+
+  printf("%lu checks, %lu failed\n", checks, failures);
+  return failures ? 1 : 0;
+}
@@ -0,0 +1,11 @@
+#ifndef EM_ADC_H
+#define EM_ADC_H
+
+/* Just the types soil_driver_bt.h declares its probes with. Nothing
+   built here touches the hardware. */
+
+typedef int ADC_PosSel_TypeDef;
+typedef int ADC_NegSel_TypeDef;
+typedef int ADC_ScanInputGroup_TypeDef;
+
+#endif // EM_ADC_H
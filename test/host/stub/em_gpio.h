@@ -0,0 +1,9 @@
+#ifndef EM_GPIO_H
+#define EM_GPIO_H
+
+/* Just the types soil_driver_bt.h declares its probes with. Nothing
+   built here touches the hardware. */
+
+typedef int GPIO_Port_TypeDef;
+
+#endif // EM_GPIO_H
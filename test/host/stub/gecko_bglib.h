@@ -0,0 +1,7 @@
+#ifndef GECKO_BGLIB_H
+#define GECKO_BGLIB_H
+
+/* The real one wires BGAPI up to a serial port. Nothing here talks to
+   a stack, so there's nothing to wire up; host_gecko.h has the rest. */
+
+#endif // GECKO_BGLIB_H
@@ -0,0 +1,161 @@
+#ifndef HOST_GECKO_H
+#define HOST_GECKO_H
+
+/* Stand-in for the host BGAPI, with just what mesh_lib.c uses: the
+   generic model events it handles and the commands it sends. Event
+   layouts and IDs match native_gecko.h. Commands don't go anywhere;
+   stub_bgapi.c records the last one and answers with stub_bgapi_result. */
+
+#include <stdint.h>
+#include <stddef.h>
+
+#include "bg_types.h"
+#include "bg_errorcodes.h"
+
+#ifndef PACKSTRUCT
+#define PACKSTRUCT(decl) decl __attribute__((__packed__))
+#endif
+
+#define BGLIB_MSG_ID(HDR) ((HDR)&0xffff00f8)
+
+enum gecko_msg_types {
+  gecko_msg_type_cmd = 0x00,
+  gecko_msg_type_rsp = 0x00,
+  gecko_msg_type_evt = 0x80
+};
+enum gecko_dev_types {
+  gecko_dev_type_gecko = 0x20
+};
+
+#define gecko_evt_mesh_generic_client_server_status_id \
+  (((uint32)gecko_dev_type_gecko) | gecko_msg_type_evt | 0x001e0000)
+#define gecko_evt_mesh_generic_server_client_request_id \
+  (((uint32)gecko_dev_type_gecko) | gecko_msg_type_evt | 0x001f0000)
+#define gecko_evt_mesh_generic_server_state_changed_id \
+  (((uint32)gecko_dev_type_gecko) | gecko_msg_type_evt | 0x011f0000)
+
+PACKSTRUCT(struct gecko_msg_mesh_generic_client_server_status_evt_t {
+  uint16 model_id;
+  uint16 elem_index;
+  uint16 client_address;
+  uint16 server_address;
+  uint32 remaining;
+  uint16 flags;
+  uint8 type;
+  uint8array parameters;
+});
+
+PACKSTRUCT(struct gecko_msg_mesh_generic_server_client_request_evt_t {
+  uint16 model_id;
+  uint16 elem_index;
+  uint16 client_address;
+  uint16 server_address;
+  uint16 appkey_index;
+  uint32 transition;
+  uint16 delay;
+  uint16 flags;
+  uint8 type;
+  uint8array parameters;
+});
+
+PACKSTRUCT(struct gecko_msg_mesh_generic_server_state_changed_evt_t {
+  uint16 model_id;
+  uint16 elem_index;
+  uint32 remaining;
+  uint8 type;
+  uint8array parameters;
+});
+
+/* Every command answers with just a result */
+PACKSTRUCT(struct gecko_msg_mesh_generic_rsp_t {
+  uint16 result;
+});
+
+#define gecko_msg_mesh_generic_client_get_rsp_t gecko_msg_mesh_generic_rsp_t
+#define gecko_msg_mesh_generic_client_set_rsp_t gecko_msg_mesh_generic_rsp_t
+#define gecko_msg_mesh_generic_client_publish_rsp_t gecko_msg_mesh_generic_rsp_t
+#define gecko_msg_mesh_generic_server_response_rsp_t gecko_msg_mesh_generic_rsp_t
+#define gecko_msg_mesh_generic_server_update_rsp_t gecko_msg_mesh_generic_rsp_t
+#define gecko_msg_mesh_generic_server_publish_rsp_t gecko_msg_mesh_generic_rsp_t
+
+/* The parameters are the last thing in each event, so the payload
+   leaves room for the longest message BGAPI can carry */
+PACKSTRUCT(struct gecko_cmd_packet {
+  uint32 header;
+  union {
+    struct gecko_msg_mesh_generic_client_server_status_evt_t evt_mesh_generic_client_server_status;
+    struct gecko_msg_mesh_generic_server_client_request_evt_t evt_mesh_generic_server_client_request;
+    struct gecko_msg_mesh_generic_server_state_changed_evt_t evt_mesh_generic_server_state_changed;
+    uint8 payload[256 + 32];
+  } data;
+});
+
+/* The last command mesh_lib sent, and what the stack says to everything */
+struct stub_bgapi_command {
+  uint32 calls;
+  uint16 model_id;
+  uint16 elem_index;
+  uint8 type;
+  uint8 len;
+  uint8 data[256];
+};
+
+extern struct stub_bgapi_command stub_bgapi_last;
+extern errorcode_t stub_bgapi_result;
+
+struct gecko_msg_mesh_generic_client_get_rsp_t *
+gecko_cmd_mesh_generic_client_get(uint16 model_id,
+                                  uint16 elem_index,
+                                  uint16 server_address,
+                                  uint16 appkey_index,
+                                  uint8 type);
+
+struct gecko_msg_mesh_generic_client_set_rsp_t *
+gecko_cmd_mesh_generic_client_set(uint16 model_id,
+                                  uint16 elem_index,
+                                  uint16 server_address,
+                                  uint16 appkey_index,
+                                  uint8 tid,
+                                  uint32 transition,
+                                  uint16 delay,
+                                  uint16 flags,
+                                  uint8 type,
+                                  uint8 parameters_len,
+                                  const uint8 *parameters_data);
+
+struct gecko_msg_mesh_generic_client_publish_rsp_t *
+gecko_cmd_mesh_generic_client_publish(uint16 model_id,
+                                      uint16 elem_index,
+                                      uint8 tid,
+                                      uint32 transition,
+                                      uint16 delay,
+                                      uint16 flags,
+                                      uint8 type,
+                                      uint8 parameters_len,
+                                      const uint8 *parameters_data);
+
+struct gecko_msg_mesh_generic_server_response_rsp_t *
+gecko_cmd_mesh_generic_server_response(uint16 model_id,
+                                       uint16 elem_index,
+                                       uint16 client_address,
+                                       uint16 appkey_index,
+                                       uint32 remaining,
+                                       uint16 flags,
+                                       uint8 type,
+                                       uint8 parameters_len,
+                                       const uint8 *parameters_data);
+
+struct gecko_msg_mesh_generic_server_update_rsp_t *
+gecko_cmd_mesh_generic_server_update(uint16 model_id,
+                                     uint16 elem_index,
+                                     uint32 remaining,
+                                     uint8 type,
+                                     uint8 parameters_len,
+                                     const uint8 *parameters_data);
+
+struct gecko_msg_mesh_generic_server_publish_rsp_t *
+gecko_cmd_mesh_generic_server_publish(uint16 model_id,
+                                      uint16 elem_index,
+                                      uint8 type);
+
+#endif // HOST_GECKO_H
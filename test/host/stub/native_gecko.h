@@ -0,0 +1,9 @@
+#ifndef NATIVE_GECKO_H
+#define NATIVE_GECKO_H
+
+/* The firmware's module headers include this for the BGAPI event
+   types. host_gecko.h has all the host builds need. */
+
+#include "host_gecko.h"
+
+#endif // NATIVE_GECKO_H
@@ -0,0 +1,117 @@
+#include <stdint.h>
+#include <string.h>
+
+#include "host_gecko.h"
+
+struct stub_bgapi_command stub_bgapi_last;
+errorcode_t stub_bgapi_result = bg_err_success;
+
+static struct gecko_msg_mesh_generic_rsp_t rsp;
+
+static struct gecko_msg_mesh_generic_rsp_t *record(uint16 model_id,
+                                                   uint16 elem_index,
+                                                   uint8 type,
+                                                   uint8 len,
+                                                   const uint8 *data)
+{
+  stub_bgapi_last.calls++;
+  stub_bgapi_last.model_id = model_id;
+  stub_bgapi_last.elem_index = elem_index;
+  stub_bgapi_last.type = type;
+  stub_bgapi_last.len = len;
+  if (len) {
+    memcpy(stub_bgapi_last.data, data, len);
+  }
+  rsp.result = stub_bgapi_result;
+  return &rsp;
+}
+
+struct gecko_msg_mesh_generic_client_get_rsp_t *
+gecko_cmd_mesh_generic_client_get(uint16 model_id,
+                                  uint16 elem_index,
+                                  uint16 server_address,
+                                  uint16 appkey_index,
+                                  uint8 type)
+{
+  (void)server_address;
+  (void)appkey_index;
+  return record(model_id, elem_index, type, 0, NULL);
+}
+
+struct gecko_msg_mesh_generic_client_set_rsp_t *
+gecko_cmd_mesh_generic_client_set(uint16 model_id,
+                                  uint16 elem_index,
+                                  uint16 server_address,
+                                  uint16 appkey_index,
+                                  uint8 tid,
+                                  uint32 transition,
+                                  uint16 delay,
+                                  uint16 flags,
+                                  uint8 type,
+                                  uint8 parameters_len,
+                                  const uint8 *parameters_data)
+{
+  (void)server_address;
+  (void)appkey_index;
+  (void)tid;
+  (void)transition;
+  (void)delay;
+  (void)flags;
+  return record(model_id, elem_index, type, parameters_len, parameters_data);
+}
+
+struct gecko_msg_mesh_generic_client_publish_rsp_t *
+gecko_cmd_mesh_generic_client_publish(uint16 model_id,
+                                      uint16 elem_index,
+                                      uint8 tid,
+                                      uint32 transition,
+                                      uint16 delay,
+                                      uint16 flags,
+                                      uint8 type,
+                                      uint8 parameters_len,
+                                      const uint8 *parameters_data)
+{
+  (void)tid;
+  (void)transition;
+  (void)delay;
+  (void)flags;
+  return record(model_id, elem_index, type, parameters_len, parameters_data);
+}
+
+struct gecko_msg_mesh_generic_server_response_rsp_t *
+gecko_cmd_mesh_generic_server_response(uint16 model_id,
+                                       uint16 elem_index,
+                                       uint16 client_address,
+                                       uint16 appkey_index,
+                                       uint32 remaining,
+                                       uint16 flags,
+                                       uint8 type,
+                                       uint8 parameters_len,
+                                       const uint8 *parameters_data)
+{
+  (void)client_address;
+  (void)appkey_index;
+  (void)remaining;
+  (void)flags;
+  return record(model_id, elem_index, type, parameters_len, parameters_data);
+}
+
+struct gecko_msg_mesh_generic_server_update_rsp_t *
+gecko_cmd_mesh_generic_server_update(uint16 model_id,
+                                     uint16 elem_index,
+                                     uint32 remaining,
+                                     uint8 type,
+                                     uint8 parameters_len,
+                                     const uint8 *parameters_data)
+{
+  (void)remaining;
+  return record(model_id, elem_index, type, parameters_len, parameters_data);
+}
+
+struct gecko_msg_mesh_generic_server_publish_rsp_t *
+gecko_cmd_mesh_generic_server_publish(uint16 model_id,
+                                      uint16 elem_index,
+                                      uint8 type)
+{
+  return record(model_id, elem_index, type, 0, NULL);
+}